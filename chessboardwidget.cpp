@@ -3,6 +3,25 @@
 #include <QPixmap>
 #include <QMouseEvent>
 
+namespace
+{
+    // Thinking time of a computer move
+    const long long COMPUTER_MOVE_MS = 3000;
+
+    QString describe(const SearchResult& result)
+    {
+        QString score = is_mate_score(result.score)
+            ? QString("mate %1").arg(mate_in_moves(result.score))
+            : QString::asprintf("%+.2f", result.score / 100.0);
+
+        QString pv;
+        for (const Move& move : result.pv)
+            pv += " " + QString::fromStdString(move_to_string(move));
+
+        return QString("depth %1  score %2  nps %3  pv%4").arg(result.depth).arg(score).arg(result.nps).arg(pv);
+    }
+}
+
 ChessBoardWidget::ChessBoardWidget(QWidget *parent)
     : QWidget{parent}
 {
@@ -10,6 +29,47 @@ ChessBoardWidget::ChessBoardWidget(QWidget *parent)
     loadPieceSprites();
 }
 
+void ChessBoardWidget::setEngine(EngineWorker* engine_worker)
+{
+    engine = engine_worker;
+
+    connect(engine, &EngineWorker::legalMovesReady, this, [this](quint64 request, int, const std::vector<Move>& legal)
+    {
+        if (request != legal_moves_request)
+            return;
+        legal_moves_request = 0;
+        moves = legal;
+        update();
+    });
+
+    connect(engine, &EngineWorker::moveApplied, this, [this](quint64 request, const Move&, const Position& position)
+    {
+        if (request != move_request)
+            return;
+        move_request = 0;
+        chess_game->add_position(position);
+        update();
+    });
+
+    connect(engine, &EngineWorker::searchProgress, this, [this](quint64 request, const SearchResult& result)
+    {
+        if (request == search_request)
+            emit statusChanged(describe(result));
+    });
+
+    connect(engine, &EngineWorker::searchFinished, this, [this](quint64 request, const SearchResult& result)
+    {
+        if (request != search_request)
+            return;
+        search_request = 0;
+
+        if (!result.has_move)
+            return;
+        emit statusChanged(describe(result) + "  bestmove " + QString::fromStdString(move_to_string(result.best_move)));
+        requestMove(result.best_move);
+    });
+}
+
 void ChessBoardWidget::loadPieceSprites()
 {
     piece_pixmaps[WHITE][PAWN]   = QPixmap(":/assets/white_pawn.png");
@@ -35,6 +95,14 @@ void ChessBoardWidget::paintEvent(QPaintEvent *event)
     int piece_size = square_size - 2 * padding;
     int offset = (square_size - piece_size) / 2;
 
+    if (piece_size != scaled_size)
+    {
+        for (int color = 0; color < 2; ++color)
+            for (int type = 0; type < 6; ++type)
+                scaled_pixmaps[color][type] = piece_pixmaps[color][type].scaled(piece_size, piece_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        scaled_size = piece_size;
+    }
+
     // 1. Draw board squares
     for (int rank = 0; rank < 8; ++rank)
     {
@@ -72,15 +140,14 @@ void ChessBoardWidget::paintEvent(QPaintEvent *event)
 
             while (bb)
             {
-                int sq = __builtin_ctzll(bb);      // bitscan forward
+                int sq = bit_scan_forward(bb);
                 bb &= bb - 1;                      // clear LSB
 
                 int rank = sq / 8;
                 int file = sq % 8;
 
-                QPixmap pieceImage = piece_pixmaps[color][type].scaled(piece_size, piece_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
                 QRect targetRect(file * square_size + padding, (7 - rank) * square_size + padding, piece_size, piece_size);
-                painter.drawPixmap(targetRect, pieceImage);
+                painter.drawPixmap(targetRect, scaled_pixmaps[color][type]);
             }
         }
     }
@@ -112,13 +179,14 @@ void ChessBoardWidget::mousePressEvent(QMouseEvent* event)
     int index = row * 8 + col;
     int bb_index = gui_to_bitboard_toggle(index);
 
+    // The board is frozen while a move is being applied or the computer is thinking
+    if (move_request || search_request)
+        return;
+
     if (selected_square == -1) {
         // First click: select a square if it has a piece of the current turn
         if (chess_game->is_valid_square(Square(bb_index)))
-        {
-            selected_square = index;
-            chess_game->legal_moves(Square(bb_index), &moves);
-        }
+            selectSquare(index, bb_index);
     } else {
         // Second click: attempt move
         int from = gui_to_bitboard_toggle(selected_square);
@@ -128,12 +196,12 @@ void ChessBoardWidget::mousePressEvent(QMouseEvent* event)
             std::vector<Move>::iterator it = find_if(moves.begin(), moves.end(), [from, to](const Move& m) { return m.from == from && m.to == to; });
             if (it != moves.end())
             {
-                chess_game->make_move(*it);
+                requestMove(*it);
                 selected_square = -1;
+                moves.clear();
             }
             else if (chess_game->is_friendly_square(Square(to))) {
-                selected_square = index;
-                chess_game->legal_moves(Square(to), &moves);
+                selectSquare(index, to);
             }
             else
             {
@@ -154,13 +222,23 @@ void ChessBoardWidget::keyPressEvent(QKeyEvent *event)
     {
         switch (key_code) {
         case Qt::Key::Key_Left:
+            cancelEngine();
             chess_game->previous_position();
             event->accept();
             break;
         case Qt::Key::Key_Right:
+            cancelEngine();
             chess_game->next_position();
             event->accept();
             break;
+        case Qt::Key::Key_Space:
+            startComputerMove();
+            event->accept();
+            break;
+        case Qt::Key::Key_Escape:
+            cancelEngine();
+            event->accept();
+            break;
         default:
 
             break;
@@ -171,6 +249,49 @@ void ChessBoardWidget::keyPressEvent(QKeyEvent *event)
     QWidget::keyPressEvent(event);
 }
 
+// Moves are validated and applied on the engine's thread; the board shows the answers as they arrive
+void ChessBoardWidget::selectSquare(int index, int bb_index)
+{
+    selected_square = index;
+    moves.clear();
+    legal_moves_request = engine->requestLegalMoves(chess_game->current_position, bb_index);
+}
+
+void ChessBoardWidget::requestMove(const Move& move)
+{
+    move_request = engine->requestMove(chess_game->current_position, move);
+}
+
+void ChessBoardWidget::startComputerMove()
+{
+    if (move_request || search_request || chess_game->current_position.state == CHECKMATE || chess_game->current_position.state == STALEMATE)
+        return;
+
+    selected_square = -1;
+    moves.clear();
+
+    // A book lookup is a few page reads, quick enough for the UI thread
+    Move book_move;
+    if (chess_game->book.pick(chess_game->current_position, book_move))
+    {
+        emit statusChanged("book move " + QString::fromStdString(move_to_string(book_move)));
+        requestMove(book_move);
+        return;
+    }
+
+    SearchLimits limits;
+    limits.time_ms = COMPUTER_MOVE_MS;
+    search_request = engine->requestSearch(chess_game->current_position, chess_game->game_history(), limits);
+}
+
+// Stops the search at once and forgets every request in flight, whose answers would be for another position
+void ChessBoardWidget::cancelEngine()
+{
+    engine->cancel();
+    legal_moves_request = move_request = search_request = 0;
+    selected_square = -1;
+}
+
 inline int ChessBoardWidget::gui_to_bitboard_toggle(int index)
 {
     int row = index / 8;     // GUI row 0 = rank 8
@@ -4,7 +4,8 @@
 #include <QWidget>
 #include <QPixmap>
 #include <map>
-#include "src/ChessGame.h"
+#include "src/chessgame.h"
+#include "engineworker.h"
 
 class ChessBoardWidget : public QWidget
 {
@@ -12,6 +13,11 @@ class ChessBoardWidget : public QWidget
 public:
     explicit ChessBoardWidget(QWidget *parent = nullptr);
     void setChessGame(ChessGame* cg) {chess_game = cg;}
+    void setEngine(EngineWorker* engine_worker);
+
+signals:
+    // Engine progress and results, for the status bar
+    void statusChanged(const QString& text);
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -20,14 +26,27 @@ protected:
 
 private:
     ChessGame* chess_game = nullptr;
+    EngineWorker* engine = nullptr;
     std::vector<Move> moves;
     int selected_square = -1;
     QPixmap piece_pixmaps[2][6];
+    // Sprites scaled to the current piece size. Scaling is slow, so it is only redone when the size changes
+    QPixmap scaled_pixmaps[2][6];
+    int scaled_size = 0;
+
+    // The engine requests whose answers are awaited, 0 for none. Answers to any other request are stale
+    quint64 legal_moves_request = 0;
+    quint64 move_request = 0;
+    quint64 search_request = 0;
     char FILES[8] { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h' };
     char RANKS[8] { '1', '2', '3', '4', '5', '6', '7', '8' };
 
     void loadPieceSprites();
     void drawPieces(QPainter& painter, int square_size);
+    void selectSquare(int index, int bb_index);
+    void requestMove(const Move& move);
+    void startComputerMove();
+    void cancelEngine();
     int gui_to_bitboard_toggle(int index);
 };
 
@@ -0,0 +1,122 @@
+#include "engineworker.h"
+#include "src/moveexec.h"
+#include "src/movegen.h"
+#include <QElapsedTimer>
+
+EngineWorker::EngineWorker(QObject *parent)
+    : QObject{parent}, game_context(new QObject), search_context(new QObject)
+{
+    game_context->moveToThread(&game_thread);
+    search_context->moveToThread(&search_thread);
+    connect(&game_thread, &QThread::finished, game_context, &QObject::deleteLater);
+    connect(&search_thread, &QThread::finished, search_context, &QObject::deleteLater);
+    game_thread.start();
+    search_thread.start();
+}
+
+EngineWorker::~EngineWorker()
+{
+    cancel();
+    game_thread.quit();
+    search_thread.quit();
+    game_thread.wait();
+    search_thread.wait();
+}
+
+template<typename Work>
+void EngineWorker::deliver(quint64 request, Work work)
+{
+    QMetaObject::invokeMethod(this, [this, request, work]()
+    {
+        if (isLive(request))
+            work();
+    }, Qt::QueuedConnection);
+}
+
+quint64 EngineWorker::requestLegalMoves(const Position& position, int square)
+{
+    quint64 request = next_request++;
+
+    QMetaObject::invokeMethod(game_context, [this, request, position, square]()
+    {
+        if (!isLive(request))
+            return;
+
+        std::vector<Move> moves;
+        legal_moves(position, Square(square), &moves);
+        deliver(request, [this, request, square, moves]() { emit legalMovesReady(request, square, moves); });
+    }, Qt::QueuedConnection);
+
+    return request;
+}
+
+quint64 EngineWorker::requestMove(const Position& position, const Move& move)
+{
+    quint64 request = next_request++;
+
+    QMetaObject::invokeMethod(game_context, [this, request, position, move]()
+    {
+        if (!isLive(request))
+            return;
+
+        // make_move also looks for checkmate and stalemate, which generates every legal reply
+        Position next = position;
+        make_move(move, next);
+        deliver(request, [this, request, move, next]() { emit moveApplied(request, move, next); });
+    }, Qt::QueuedConnection);
+
+    return request;
+}
+
+quint64 EngineWorker::requestSearch(const Position& position, const std::vector<Bitboard>& history, const SearchLimits& limits)
+{
+    quint64 request = next_request++;
+
+    // The previous search ends at its next limit check, before this one starts on the same thread
+    latest_search.store(request);
+    stop_search.store(true);
+    searching = true;
+
+    QMetaObject::invokeMethod(search_context, [this, request, position, history, limits]()
+    {
+        if (!isLive(request) || request != latest_search.load())
+            return;
+
+        // A cancel() or a newer requestSearch() that raced with the reset is caught either here or by the search's
+        // next limit check
+        stop_search.store(false);
+        if (!isLive(request) || request != latest_search.load())
+            return;
+
+        SearchLimits search_limits = limits;
+        search_limits.stop = &stop_search;
+
+        QElapsedTimer since_progress;
+        since_progress.start();
+
+        SearchResult result = search(position, search_limits, table, history, [&](const SearchResult& iteration)
+        {
+            // Early iterations finish far faster than the board repaints, so only some of them are shown
+            if (since_progress.elapsed() < PROGRESS_INTERVAL_MS)
+                return;
+            since_progress.restart();
+            deliver(request, [this, request, iteration]() { emit searchProgress(request, iteration); });
+        });
+
+        deliver(request, [this, request, result]()
+        {
+            if (request == latest_search.load())
+                searching = false;
+            emit searchFinished(request, result);
+        });
+    }, Qt::QueuedConnection);
+
+    return request;
+}
+
+void EngineWorker::cancel()
+{
+    first_live_request.store(next_request);
+    stop_search.store(true);
+    searching = false;
+}
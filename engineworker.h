@@ -0,0 +1,62 @@
+#ifndef ENGINEWORKER_H
+#define ENGINEWORKER_H
+
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <vector>
+#include "src/search.h"
+
+// Runs engine work off the UI thread. Move validation and game state updates run on one worker thread and searches
+// on another, so a long search never delays a click. Answers arrive as signals on the thread that owns the worker,
+// each tagged with the id its request returned; answers to requests older than the last cancel() are dropped
+class EngineWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit EngineWorker(QObject *parent = nullptr);
+    ~EngineWorker();
+
+    quint64 requestLegalMoves(const Position& position, int square);
+    quint64 requestMove(const Position& position, const Move& move);
+    // Replaces the running search, if any
+    quint64 requestSearch(const Position& position, const std::vector<Bitboard>& history, const SearchLimits& limits);
+    // Stops the running search at once and drops every answer not yet delivered
+    void cancel();
+    bool isSearching() const { return searching; }
+
+signals:
+    void legalMovesReady(quint64 request, int square, const std::vector<Move>& moves);
+    // The position after the move, its game state updated
+    void moveApplied(quint64 request, const Move& move, const Position& position);
+    // Completed iterations, no more often than every PROGRESS_INTERVAL_MS
+    void searchProgress(quint64 request, const SearchResult& result);
+    void searchFinished(quint64 request, const SearchResult& result);
+
+private:
+    static constexpr qint64 PROGRESS_INTERVAL_MS = 100;
+
+    QThread game_thread;
+    QThread search_thread;
+    // Live on the two threads, so work queued to them runs there
+    QObject* game_context;
+    QObject* search_context;
+
+    // Only used by searches, on the search thread. Kept across them, so analysis of earlier moves carries over
+    TranspositionTable table { 16 };
+    std::atomic<bool> stop_search { false };
+    // Requests with a lower id than this were cancelled
+    std::atomic<quint64> first_live_request { 1 };
+    // Searches queued before this one are skipped
+    std::atomic<quint64> latest_search { 0 };
+    // 0 is never handed out, so callers can use it for "no request"
+    quint64 next_request = 1;
+    bool searching = false;
+
+    bool isLive(quint64 request) const { return request >= first_live_request.load(); }
+    // Runs work on the UI thread, unless the request was cancelled in the meantime
+    template<typename Work>
+    void deliver(quint64 request, Work work);
+};
+
+#endif // ENGINEWORKER_H
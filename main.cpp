@@ -1,6 +1,9 @@
 #include "mainwindow.h"
+#include "nnue.h"
+#include "tablebase.h"
 
 #include <QApplication>
+#include <QFileInfo>
 #include <QLocale>
 #include <QTranslator>
 
@@ -17,6 +20,18 @@ int main(int argc, char *argv[])
             break;
         }
     }
+
+    // Search with the network shipped next to the executable, if any, and the hand-written evaluation otherwise
+    const QString network = QCoreApplication::applicationDirPath() + "/network.nnue";
+    std::string error;
+    if (QFileInfo::exists(network) && !nnue_load(network.toStdString(), error))
+        qWarning("%s", error.c_str());
+
+    // Likewise the endgame tablebases built by tbgen
+    const QString tablebases = QCoreApplication::applicationDirPath() + "/tablebases";
+    if (QFileInfo::exists(tablebases) && !tablebase_load(tablebases.toStdString(), error))
+        qWarning("%s", error.c_str());
+
     MainWindow w;
     w.show();
     return a.exec();
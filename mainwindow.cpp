@@ -1,4 +1,7 @@
 #include "mainwindow.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QStatusBar>
 #include <QVBoxLayout>
 
 MainWindow::MainWindow(QWidget *parent)
@@ -15,11 +18,23 @@ MainWindow::MainWindow(QWidget *parent)
     chess_game = new ChessGame();
     chess_board_widget->setChessGame(chess_game);
 
+    // An opening book shipped next to the executable is used for computer moves
+    const QString book_path = QCoreApplication::applicationDirPath() + "/book.bin";
+    std::string error;
+    if (QFileInfo::exists(book_path) && !chess_game->book.open(book_path.toStdString(), error))
+        qWarning("%s", error.c_str());
+
+    engine = new EngineWorker(this);
+    chess_board_widget->setEngine(engine);
+    connect(chess_board_widget, &ChessBoardWidget::statusChanged, this, [this](const QString& text) { statusBar()->showMessage(text); });
+
     layout->addWidget(chess_board_widget);
 }
 
 MainWindow::~MainWindow()
 {
+    // Stops the engine threads before the game they were working for goes away
+    delete engine;
     delete chess_board_widget;
     delete chess_game;
 }
@@ -3,7 +3,7 @@
 
 #include <QMainWindow>
 #include "chessboardwidget.h"
-#include "src/ChessGame.h"
+#include "src/chessgame.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -22,5 +22,6 @@ public:
 private:
     ChessBoardWidget *chess_board_widget;
     ChessGame* chess_game;
+    EngineWorker* engine;
 };
 #endif // MAINWINDOW_H
@@ -13,13 +13,3 @@ const int INDEX64[64] =
 };
 
 const Bitboard DEBRUIJN64 = 0x03f79d71b4cb0a89;
-
-int pop_count(Bitboard bitboard)
-{
-    int count = 0;
-    while (bitboard) {
-        count++;
-        bitboard &= bitboard - 1;
-    }
-    return count;
-}
@@ -1,9 +1,23 @@
 #ifndef BITBOARD_H
 #define BITBOARD_H
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if __cplusplus >= 202002L
+#include <bit>
+#endif
+
+// Hardware PEXT/PDEP is only used when the whole build targets BMI2 (-mbmi2, or /arch:AVX2 with MSVC)
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define BITBOARD_HW_BMI2
+#include <immintrin.h>
+#endif
+
 typedef unsigned long long Bitboard;
 
-// De Bruijn sequence to 64-index mapping
+// De Bruijn sequence to 64-index mapping. Bit scan fallback for compilers without scan intrinsics
 extern const int INDEX64[64];
 
 // De Bruijn sequence over alphabet {0, 1}. B(2, 6)
@@ -12,8 +26,40 @@ extern const Bitboard DEBRUIJN64;
 inline void set_bit(Bitboard& bitboard, int square) { bitboard |= (1ULL << square); }
 inline Bitboard to_bb(int sq) { return 1ULL << sq; }
 inline Bitboard bitboard_union(Bitboard bitboard1, Bitboard bitboard2) { return bitboard1 | bitboard2; }
-inline int bit_scan_forward(Bitboard bitboard) { return bitboard ? (INDEX64[((bitboard ^ (bitboard - 1)) * DEBRUIJN64) >> 58]) : -1; }
-inline int bit_scan_reverse(Bitboard bitboard) {
+
+/*
+    Bit manipulation layer. Each function maps to a compiler intrinsic where one exists and falls back to portable code
+    otherwise. The intrinsics compile to the best instruction the target allows (e.g. BSF or TZCNT, a libgcc call or
+    POPCNT), and functions marked HOT_DISPATCH (see cpu.h) are compiled once per instruction set level so a single
+    binary picks POPCNT/TZCNT/LZCNT at load time on hosts that have them
+*/
+
+// Index of the least significant set bit, -1 for an empty bitboard
+inline int bit_scan_forward(Bitboard bitboard)
+{
+    if (!bitboard) return -1;
+#if defined(__GNUC__)
+    return __builtin_ctzll(bitboard);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bitboard);
+    return int(index);
+#else
+    return INDEX64[((bitboard ^ (bitboard - 1)) * DEBRUIJN64) >> 58];
+#endif
+}
+
+// Index of the most significant set bit, -1 for an empty bitboard
+inline int bit_scan_reverse(Bitboard bitboard)
+{
+    if (!bitboard) return -1;
+#if defined(__GNUC__)
+    return 63 ^ __builtin_clzll(bitboard);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, bitboard);
+    return int(index);
+#else
     bitboard |= bitboard >> 1;
     bitboard |= bitboard >> 2;
     bitboard |= bitboard >> 4;
@@ -21,6 +67,68 @@ inline int bit_scan_reverse(Bitboard bitboard) {
     bitboard |= bitboard >> 16;
     bitboard |= bitboard >> 32;
     return INDEX64[(bitboard * DEBRUIJN64) >> 58];
+#endif
+}
+
+inline int pop_count(Bitboard bitboard)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(bitboard);
+#elif defined(_MSC_VER) && defined(_M_X64) && defined(__AVX__)
+    return int(__popcnt64(bitboard));
+#else
+    // SWAR count, branch free unlike clearing one bit at a time
+    bitboard = bitboard - ((bitboard >> 1) & 0x5555555555555555ULL);
+    bitboard = (bitboard & 0x3333333333333333ULL) + ((bitboard >> 2) & 0x3333333333333333ULL);
+    bitboard = (bitboard + (bitboard >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return int((bitboard * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Compiled to a single rol instruction by GCC, Clang and MSVC
+inline Bitboard rotate_left(Bitboard bitboard, int shift)
+{
+#if __cplusplus >= 202002L
+    return std::rotl(bitboard, shift);
+#elif defined(_MSC_VER)
+    return _rotl64(bitboard, shift);
+#else
+    return (bitboard << (shift & 63)) | (bitboard >> ((64 - shift) & 63));
+#endif
+}
+
+// Parallel bit extract: gathers the bits of bitboard selected by mask into the low bits of the result
+inline Bitboard pext(Bitboard bitboard, Bitboard mask)
+{
+#if defined(BITBOARD_HW_BMI2)
+    return _pext_u64(bitboard, mask);
+#else
+    Bitboard result = 0ULL;
+    for (Bitboard bit = 1ULL; mask; bit <<= 1)
+    {
+        if (bitboard & mask & (0ULL - mask))
+            result |= bit;
+        mask &= mask - 1;
+    }
+    return result;
+#endif
+}
+
+// Parallel bit deposit: scatters the low bits of bitboard to the positions selected by mask
+inline Bitboard pdep(Bitboard bitboard, Bitboard mask)
+{
+#if defined(BITBOARD_HW_BMI2)
+    return _pdep_u64(bitboard, mask);
+#else
+    Bitboard result = 0ULL;
+    for (Bitboard bit = 1ULL; mask; bit <<= 1)
+    {
+        if (bitboard & bit)
+            result |= mask & (0ULL - mask);
+        mask &= mask - 1;
+    }
+    return result;
+#endif
 }
 
 inline Bitboard north_shift(Bitboard bitboard, int shift) { return bitboard << (8 * shift); }
@@ -32,6 +140,4 @@ inline Bitboard south_west_shift(Bitboard bitboard, int shift) { return bitboard
 inline Bitboard west_shift(Bitboard bitboard, int shift) { return bitboard >> (1 * shift); }
 inline Bitboard north_west_shift(Bitboard bitboard, int shift) { return bitboard << (7 * shift); }
 
-int pop_count(Bitboard bitboard);
-
 #endif // BITBOARD_H
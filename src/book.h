@@ -0,0 +1,42 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "mappedfile.h"
+#include "position.h"
+#include <string>
+#include <vector>
+
+/*
+    Polyglot opening books. A book is an array of 16-byte big-endian entries (position key, move, weight, learn),
+    sorted by key. It is memory-mapped and binary-searched, so opening a book of any size reads nothing up front and a
+    lookup touches a handful of pages.
+
+    Positions are keyed like Polyglot does, by XORing together the numbers of its Random64 array for the pieces, castling
+    rights, en passant file and side to move.
+*/
+// Polyglot key of a position
+Bitboard polyglot_key(const Position& position);
+
+struct BookMove
+{
+    Move move;
+    int weight;
+};
+
+class OpeningBook
+{
+public:
+    bool open(const std::string& path, std::string& error);
+    void close() { file.close(); }
+    bool is_open() const { return file.is_open(); }
+
+    // Legal book moves of a position with a non-zero weight, highest weight first. Empty without a book
+    std::vector<BookMove> probe(const Position& position) const;
+    // One of the book moves, chosen with probability proportional to its weight. False when there are none
+    bool pick(const Position& position, Move& move) const;
+
+private:
+    MappedFile file;
+};
+
+#endif // BOOK_H
@@ -1,19 +1,22 @@
 ﻿#include "chessgame.h"
+#include "evaluate.h"
 #include "moveexec.h"
 #include "movegen.h"
+#include "zobrist.h"
+#include <algorithm>
 #include <string>
 
 ChessGame::ChessGame(Position position)
 {
     current_position = position;
+    update_occupancies(current_position);
+    current_position.hash = position_hash(current_position);
+    compute_psq(current_position);
 
     position_index = 0;
     position_history.push_back(current_position);
+    hash_history.push_back(current_position.hash);
     position_history_size = 1;
-
-    position_history_3fold[pos_stringid(position)] = 1;
-	init_rays();
-	update_occupancies(position);
 }
 
 ChessGame::ChessGame(std::string fen) : ChessGame(fen_to_pos(fen)) {}
@@ -38,12 +41,31 @@ Bitboard ChessGame::legal_moves(Square square, std::vector<Move> *legal_moves_li
 
 void ChessGame::make_move(const Move &move)
 {
-    ::make_move(move, current_position);
+    Position next = current_position;
+    ::make_move(move, next);
+    add_position(next);
+}
+
+void ChessGame::add_position(const Position& position)
+{
+    current_position = position;
     position_history_size = ++position_index;
     if (position_history.size() > position_history_size)
+    {
         position_history[position_history_size] = current_position;
+        hash_history[position_history_size] = current_position.hash;
+    }
     else
+    {
         position_history.push_back(current_position);
+        hash_history.push_back(current_position.hash);
+    }
+
+    if (current_position.state != CHECKMATE && is_threefold_repetition())
+    {
+        current_position.state = REPETITION;
+        position_history[position_index] = current_position;
+    }
 }
 
 bool ChessGame::is_friendly_square(Square square)
@@ -62,3 +84,28 @@ void ChessGame::next_position()
     position_index = std::min(position_history_size, position_index + 1);
     current_position = position_history[position_index];
 }
+
+bool ChessGame::is_threefold_repetition() const
+{
+    // Positions before the last capture or pawn move can never recur, and only every other ply has the same side to move
+    int oldest = std::max(0, position_index - current_position.halfmove_clock);
+    int repetitions = 1;
+
+    for (int i = position_index - 2; i >= oldest; i -= 2)
+    {
+        if (hash_history[i] == current_position.hash && ++repetitions == 3)
+            return true;
+    }
+
+    return false;
+}
+
+std::vector<Bitboard> ChessGame::game_history() const
+{
+    return std::vector<Bitboard>(hash_history.begin(), hash_history.begin() + position_index);
+}
+
+SearchResult ChessGame::search(const SearchLimits& limits, TranspositionTable& table, const SearchCallback& on_iteration) const
+{
+    return ::search(current_position, limits, table, game_history(), on_iteration);
+}
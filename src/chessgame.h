@@ -1,6 +1,7 @@
 #pragma once
+#include "book.h"
 #include "position.h"
-#include <map>
+#include "search.h"
 #include <vector>
 
 class ChessGame
@@ -8,8 +9,11 @@ class ChessGame
 public:
     std::vector<Position> position_history;
 
-    std::map<std::string, int> position_history_3fold;
+    // Hash of every position in position_history, scanned for threefold repetition
+    std::vector<Bitboard> hash_history;
     Position current_position;
+    // Polyglot book consulted before searching, when one is open
+    OpeningBook book;
 
 	ChessGame(Position position = starting_position);
 	ChessGame(std::string fen);
@@ -18,9 +22,18 @@ public:
     bool is_valid_square(int square);
     Bitboard legal_moves(Square square, std::vector<Move>* legal_moves_list = nullptr);
     void make_move(const Move& move);
+    // Appends a position reached from the current one by a move made elsewhere, e.g. on the engine thread, with its
+    // game state already updated. Any positions after the current one are dropped
+    void add_position(const Position& position);
     bool is_friendly_square(Square square);
     void previous_position();
     void next_position();
+    bool is_threefold_repetition() const;
+    // Hashes of the game positions before the current one, for the search's repetition detection
+    std::vector<Bitboard> game_history() const;
+    // Searches the current position for the side to move, with the game so far counted for repetitions. The caller owns
+    // the table, so one can serve every game and be kept across searches
+    SearchResult search(const SearchLimits& limits, TranspositionTable& table, const SearchCallback& on_iteration = nullptr) const;
 
 private:
     int position_index;
@@ -0,0 +1,92 @@
+#include "cpu.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace
+{
+    // Returns false when the leaf is not available (or the CPU is not x86)
+    bool cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4])
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4];
+        __cpuid(info, int(leaf & 0x80000000));
+        if (unsigned(info[0]) < leaf) return false;
+        __cpuidex(info, int(leaf), int(subleaf));
+        for (int i = 0; i < 4; ++i) regs[i] = unsigned(info[i]);
+        return true;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        return __get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]);
+#else
+        (void)leaf;
+        (void)subleaf;
+        (void)regs;
+        return false;
+#endif
+    }
+
+    CpuFeatures detect()
+    {
+        CpuFeatures features;
+        unsigned regs[4] = {};
+
+        if (!cpuid(0, 0, regs)) return features;
+
+        // Vendor string is spread over ebx, edx, ecx
+        bool amd = regs[1] == 0x68747541 && regs[3] == 0x69746E65 && regs[2] == 0x444D4163;
+
+        unsigned family = 0;
+        if (cpuid(1, 0, regs))
+        {
+            features.popcnt = regs[2] & (1u << 23);
+            family = (regs[0] >> 8) & 0xF;
+            if (family == 0xF)
+                family += (regs[0] >> 20) & 0xFF;
+        }
+
+        if (cpuid(7, 0, regs))
+        {
+            features.bmi1 = regs[1] & (1u << 3);
+            features.avx2 = regs[1] & (1u << 5);
+            features.bmi2 = regs[1] & (1u << 8);
+        }
+
+        if (cpuid(0x80000001, 0, regs))
+            features.lzcnt = regs[2] & (1u << 5);
+
+        features.fast_pext = features.bmi2 && !(amd && family < 0x19);
+
+        return features;
+    }
+}
+
+const CpuFeatures& cpu_features()
+{
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+std::string cpu_feature_string()
+{
+    const CpuFeatures& features = cpu_features();
+    std::string str;
+
+    auto add = [&str](bool present, const char* name)
+    {
+        if (!present) return;
+        if (!str.empty()) str += ' ';
+        str += name;
+    };
+
+    add(features.popcnt, "popcnt");
+    add(features.bmi1, "bmi1");
+    add(features.bmi2, "bmi2");
+    add(features.lzcnt, "lzcnt");
+    add(features.avx2, "avx2");
+    add(features.fast_pext, "fast-pext");
+
+    return str.empty() ? "none" : str;
+}
@@ -0,0 +1,32 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <string>
+
+// Instruction set extensions of the host CPU, detected once with cpuid
+struct CpuFeatures
+{
+    bool popcnt = false;
+    bool bmi1 = false;
+    bool bmi2 = false;
+    bool lzcnt = false;
+    bool avx2 = false;
+    // BMI2 with a fast PEXT/PDEP. AMD before Zen 3 implements them in microcode
+    bool fast_pext = false;
+};
+
+const CpuFeatures& cpu_features();
+
+// e.g. "popcnt bmi1 bmi2 lzcnt avx2", for benchmark reports
+std::string cpu_feature_string();
+
+// Compiles a hot function once per instruction set level. The dynamic loader resolves each call to the best clone
+// the host supports, so inlined bit_scan_forward/pop_count become TZCNT/POPCNT without requiring them of every CPU.
+// Needs GCC ifunc support (x86-64 ELF); elsewhere, or when the whole build already targets BMI2, it expands to nothing
+#if defined(CPU_DISPATCH) && defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__ELF__) && !defined(USE_PEXT)
+#define HOT_DISPATCH __attribute__((target_clones("arch=haswell", "popcnt", "default")))
+#else
+#define HOT_DISPATCH
+#endif
+
+#endif // CPU_H
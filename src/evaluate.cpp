@@ -0,0 +1,301 @@
+#include "evaluate.h"
+#include "movegen.h"
+#include <algorithm>
+
+const int PIECE_VALUES[6] = { 100, 500, 320, 330, 900, 0 };
+
+namespace
+{
+    enum Phase { MIDGAME, ENDGAME };
+
+    // Material of each piece type in the midgame and the endgame
+    constexpr int MATERIAL[2][6] =
+    {
+        { 100, 500, 320, 330, 900, 0 },
+        { 120, 540, 300, 320, 950, 0 },
+    };
+
+    // Midgame piece-square bonuses from white's point of view, laid out as seen from white's side of the board
+    // (a8 first). Index with square ^ 56 for white and square for black
+    constexpr int PIECE_SQUARE[6][64] =
+    {
+        // Pawn
+        {
+              0,   0,   0,   0,   0,   0,   0,   0,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             10,  10,  20,  30,  30,  20,  10,  10,
+              5,   5,  10,  25,  25,  10,   5,   5,
+              0,   0,   0,  20,  20,   0,   0,   0,
+              5,  -5, -10,   0,   0, -10,  -5,   5,
+              5,  10,  10, -20, -20,  10,  10,   5,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        // Rook
+        {
+              0,   0,   0,   0,   0,   0,   0,   0,
+              5,  10,  10,  10,  10,  10,  10,   5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+              0,   0,   0,   5,   5,   0,   0,   0,
+        },
+        // Knight
+        {
+            -50, -40, -30, -30, -30, -30, -40, -50,
+            -40, -20,   0,   0,   0,   0, -20, -40,
+            -30,   0,  10,  15,  15,  10,   0, -30,
+            -30,   5,  15,  20,  20,  15,   5, -30,
+            -30,   0,  15,  20,  20,  15,   0, -30,
+            -30,   5,  10,  15,  15,  10,   5, -30,
+            -40, -20,   0,   5,   5,   0, -20, -40,
+            -50, -40, -30, -30, -30, -30, -40, -50,
+        },
+        // Bishop
+        {
+            -20, -10, -10, -10, -10, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,  10,  10,   5,   0, -10,
+            -10,   5,   5,  10,  10,   5,   5, -10,
+            -10,   0,  10,  10,  10,  10,   0, -10,
+            -10,  10,  10,  10,  10,  10,  10, -10,
+            -10,   5,   0,   0,   0,   0,   5, -10,
+            -20, -10, -10, -10, -10, -10, -10, -20,
+        },
+        // Queen
+        {
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,   5,   5,   5,   0, -10,
+             -5,   0,   5,   5,   5,   5,   0,  -5,
+              0,   0,   5,   5,   5,   5,   0,  -5,
+            -10,   5,   5,   5,   5,   5,   0, -10,
+            -10,   0,   5,   0,   0,   0,   0, -10,
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+        },
+        // King
+        {
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -20, -30, -30, -40, -40, -30, -30, -20,
+            -10, -20, -20, -20, -20, -20, -20, -10,
+             20,  20,   0,   0,   0,   0,  20,  20,
+             20,  30,  10,   0,   0,  10,  30,  20,
+        },
+    };
+
+    // Endgame tables of the pieces whose best squares change once the queens are off: pawns are worth more the
+    // closer they are to promoting and the king belongs in the centre. The other pieces keep their midgame tables
+    constexpr int PAWN_ENDGAME[64] =
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         80,  80,  80,  80,  80,  80,  80,  80,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         30,  30,  30,  30,  30,  30,  30,  30,
+         15,  15,  15,  15,  15,  15,  15,  15,
+          5,   5,   5,   5,   5,   5,   5,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    };
+
+    constexpr int KING_ENDGAME[64] =
+    {
+        -50, -40, -30, -20, -20, -30, -40, -50,
+        -30, -20, -10,   0,   0, -10, -20, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -30,   0,   0,   0,   0, -30, -30,
+        -50, -30, -30, -30, -30, -30, -30, -50,
+    };
+
+    constexpr PieceSquareTable generate_psqt()
+    {
+        PieceSquareTable table {};
+
+        for (int color = WHITE; color <= BLACK; ++color)
+        {
+            int flip = color == WHITE ? 56 : 0;
+            int sign = color == WHITE ? 1 : -1;
+
+            for (int type = PAWN; type <= KING; ++type)
+            {
+                for (int sq = a1; sq <= h8; ++sq)
+                {
+                    int midgame = PIECE_SQUARE[type][sq ^ flip];
+                    int endgame = type == PAWN ? PAWN_ENDGAME[sq ^ flip] : type == KING ? KING_ENDGAME[sq ^ flip] : midgame;
+                    table.value[color][type][sq][MIDGAME] = sign * (MATERIAL[MIDGAME][type] + midgame);
+                    table.value[color][type][sq][ENDGAME] = sign * (MATERIAL[ENDGAME][type] + endgame);
+                }
+            }
+        }
+
+        return table;
+    }
+
+    // Game phase contributed by each piece type. All pieces on the board add up to MAX_PHASE, a pure midgame
+    const int PHASE_WEIGHT[6] = { 0, 2, 1, 1, 4, 0 };
+    const int MAX_PHASE = 24;
+
+    // Bonus per square a piece attacks that is neither its own nor covered by an enemy pawn, [phase][piece type]
+    const int MOBILITY[2][6] =
+    {
+        { 0, 2, 4, 4, 1, 0 },
+        { 0, 4, 4, 4, 2, 0 },
+    };
+
+    // Midgame penalty per attack on the squares around the king, by attacking piece type
+    const int KING_ZONE_ATTACK[6] = { 0, 6, 5, 5, 8, 0 };
+    // Midgame bonus per pawn on the squares in front of the king
+    const int PAWN_SHIELD = 12;
+
+    // Pawn structure penalties and passed pawn bonuses by relative rank, [phase]
+    const int DOUBLED_PAWN[2] = { 10, 20 };
+    const int ISOLATED_PAWN[2] = { 10, 15 };
+    const int PASSED_PAWN[2][8] =
+    {
+        { 0, 5, 10, 15, 25, 40, 60, 0 },
+        { 0, 10, 20, 35, 60, 100, 150, 0 },
+    };
+
+    Bitboard pawn_attack_set(Bitboard pawns, int color)
+    {
+        return color == WHITE ? north_east_one(pawns) | north_west_one(pawns) : south_east_one(pawns) | south_west_one(pawns);
+    }
+
+    Bitboard adjacent_files(int file)
+    {
+        Bitboard files = A_FILE << file;
+        return east_one(files) | west_one(files);
+    }
+
+    // Ranks strictly in front of a pawn on square, from color's point of view
+    Bitboard forward_ranks(int square, int color)
+    {
+        int rank = square / 8;
+        return color == WHITE ? ~0ULL << (8 * (rank + 1)) : (1ULL << (8 * rank)) - 1;
+    }
+
+    // Doubled, isolated and passed pawns of color, added to score from color's point of view
+    void evaluate_pawns(const Position& position, int color, int score[2])
+    {
+        Bitboard pawns = position.pieces[color][PAWN];
+        Bitboard enemy_pawns = position.pieces[color ^ 1][PAWN];
+
+        for (int file = 0; file < 8; ++file)
+        {
+            Bitboard on_file = pawns & (A_FILE << file);
+            if (!on_file)
+                continue;
+
+            int count = pop_count(on_file);
+            score[MIDGAME] -= (count - 1) * DOUBLED_PAWN[MIDGAME];
+            score[ENDGAME] -= (count - 1) * DOUBLED_PAWN[ENDGAME];
+
+            if (!(pawns & adjacent_files(file)))
+            {
+                score[MIDGAME] -= count * ISOLATED_PAWN[MIDGAME];
+                score[ENDGAME] -= count * ISOLATED_PAWN[ENDGAME];
+            }
+        }
+
+        while (pawns)
+        {
+            int sq = bit_scan_forward(pawns);
+            pawns &= pawns - 1;
+
+            int file = sq % 8;
+            if (enemy_pawns & forward_ranks(sq, color) & ((A_FILE << file) | adjacent_files(file)))
+                continue;
+
+            int relative_rank = color == WHITE ? sq / 8 : 7 - sq / 8;
+            score[MIDGAME] += PASSED_PAWN[MIDGAME][relative_rank];
+            score[ENDGAME] += PASSED_PAWN[ENDGAME][relative_rank];
+        }
+    }
+
+    // Mobility of color's pieces and their pressure on the enemy king, plus color's pawn shield, added to score from
+    // color's point of view
+    void evaluate_pieces(const Position& position, int color, int score[2])
+    {
+        int enemy = color ^ 1;
+        Bitboard mobility_area = ~position.occupancy[color] & ~pawn_attack_set(position.pieces[enemy][PAWN], enemy);
+
+        Square enemy_king = Square(bit_scan_forward(position.pieces[enemy][KING]));
+        Bitboard king_zone = king_attacks(enemy_king) | (1ULL << enemy_king);
+        int king_attack = 0;
+
+        for (int type = ROOK; type <= QUEEN; ++type)
+        {
+            Bitboard pieces = position.pieces[color][type];
+            while (pieces)
+            {
+                Square sq = Square(bit_scan_forward(pieces));
+                pieces &= pieces - 1;
+
+                Bitboard attacks = type == KNIGHT ? knight_attacks(sq)
+                                 : type == BISHOP ? bishop_attacks(position.all_occupancy, sq)
+                                 : type == ROOK ? rook_attacks(position.all_occupancy, sq)
+                                 : queen_attacks(position.all_occupancy, sq);
+
+                int mobility = pop_count(attacks & mobility_area);
+                score[MIDGAME] += mobility * MOBILITY[MIDGAME][type];
+                score[ENDGAME] += mobility * MOBILITY[ENDGAME][type];
+                king_attack += pop_count(attacks & king_zone) * KING_ZONE_ATTACK[type];
+            }
+        }
+        score[MIDGAME] += king_attack;
+
+        Square king = Square(bit_scan_forward(position.pieces[color][KING]));
+        Bitboard shield = king_attacks(king) & forward_ranks(king, color) & position.pieces[color][PAWN];
+        score[MIDGAME] += pop_count(shield) * PAWN_SHIELD;
+    }
+}
+
+constexpr PieceSquareTable PSQT = generate_psqt();
+
+void compute_psq(Position& position)
+{
+    position.psq[MIDGAME] = position.psq[ENDGAME] = 0;
+
+    for (int color = WHITE; color <= BLACK; ++color)
+    {
+        for (int type = PAWN; type <= KING; ++type)
+        {
+            Bitboard pieces = position.pieces[color][type];
+            while (pieces)
+            {
+                add_piece_score(position, color, type, bit_scan_forward(pieces));
+                pieces &= pieces - 1;
+            }
+        }
+    }
+}
+
+int evaluate(const Position& position)
+{
+    // Running material and piece-square score, then the terms that depend on how the pieces interact
+    int score[2] = { position.psq[MIDGAME], position.psq[ENDGAME] };
+    int side_score[2][2] = {};
+
+    for (int color = WHITE; color <= BLACK; ++color)
+    {
+        evaluate_pieces(position, color, side_score[color]);
+        evaluate_pawns(position, color, side_score[color]);
+    }
+    score[MIDGAME] += side_score[WHITE][MIDGAME] - side_score[BLACK][MIDGAME];
+    score[ENDGAME] += side_score[WHITE][ENDGAME] - side_score[BLACK][ENDGAME];
+
+    // Blend the midgame and endgame scores by the material left on the board
+    int phase = 0;
+    for (int type = ROOK; type <= QUEEN; ++type)
+        phase += PHASE_WEIGHT[type] * pop_count(position.pieces[WHITE][type] | position.pieces[BLACK][type]);
+    phase = std::min(phase, MAX_PHASE);
+
+    int blended = (score[MIDGAME] * phase + score[ENDGAME] * (MAX_PHASE - phase)) / MAX_PHASE;
+    return position.color_to_move == WHITE ? blended : -blended;
+}
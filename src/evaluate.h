@@ -0,0 +1,38 @@
+#ifndef EVALUATE_H
+#define EVALUATE_H
+
+#include "position.h"
+
+// Material value of each piece type in centipawns, indexed by PieceType
+extern const int PIECE_VALUES[6];
+
+// Material plus piece-square value of a piece on a square, signed from white's point of view
+struct PieceSquareTable
+{
+    // [color][piece type][square][0 = midgame, 1 = endgame]
+    int value[2][6][64][2];
+};
+
+extern const PieceSquareTable PSQT;
+
+// Keep Position::psq up to date as pieces are placed and removed
+inline void add_piece_score(Position& position, int color, int type, int square)
+{
+    position.psq[0] += PSQT.value[color][type][square][0];
+    position.psq[1] += PSQT.value[color][type][square][1];
+}
+
+inline void remove_piece_score(Position& position, int color, int type, int square)
+{
+    position.psq[0] -= PSQT.value[color][type][square][0];
+    position.psq[1] -= PSQT.value[color][type][square][1];
+}
+
+// Sets Position::psq from scratch
+void compute_psq(Position& position);
+
+// Static evaluation in centipawns from the point of view of the side to move. Tapered between a midgame and an
+// endgame score by the material left: the running piece-square score plus mobility, king safety and pawn structure
+int evaluate(const Position& position);
+
+#endif // EVALUATE_H
@@ -0,0 +1,99 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& path, std::string& error)
+{
+    void* data = nullptr;
+    size_t size = 0;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    size = size_t(file_size.QuadPart);
+
+    // The view stays valid once the file and mapping handles are closed
+    HANDLE handle = size ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+    data = handle ? MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (handle)
+        CloseHandle(handle);
+    if (!data)
+    {
+        error = "cannot map " + path;
+        return false;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        error = "cannot read " + path;
+        return false;
+    }
+    size = size_t(st.st_size);
+
+    // The mapping stays valid once the descriptor is closed
+    data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        error = "cannot map " + path;
+        return false;
+    }
+#endif
+
+    close();
+    mapping = data;
+    length = size;
+    return true;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        mapping = other.mapping;
+        length = other.length;
+        other.mapping = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+void MappedFile::close()
+{
+    if (!mapping)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, length);
+#endif
+    mapping = nullptr;
+    length = 0;
+}
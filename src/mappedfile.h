@@ -0,0 +1,32 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are read from disk on first touch and shared with every other
+// process mapping the same file, so large files cost nothing to open
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept : mapping(other.mapping), length(other.length) { other.mapping = nullptr; other.length = 0; }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Replaces the file mapped before, which stays mapped when path cannot be
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    bool is_open() const { return mapping != nullptr; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(mapping); }
+    size_t size() const { return length; }
+
+private:
+    void* mapping = nullptr;
+    size_t length = 0;
+};
+
+#endif // MAPPEDFILE_H
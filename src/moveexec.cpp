@@ -1,135 +1,165 @@
 #include "moveexec.h"
+#include "evaluate.h"
 #include "movegen.h"
+#include "zobrist.h"
 
 void update_game_state(Position& position)
 {
+    MoveList list;
+    generate_legal(position, list);
+
+    bool in_check = is_king_in_check(position, position.color_to_move ^ 1);
+
+    if (list.size)
+        position.state = in_check ? CHECK : NORMAL;
+    else
+        position.state = in_check ? CHECKMATE : STALEMATE;
+}
+
+// Moves the pieces of the side to move on the board, updates the clocks, hash and score and passes the turn. Shared by test_move and make_move
+static void move_pieces(const Move& move, Position& position)
+{
+    Bitboard from_bb = (1ULL << move.from);
+    Bitboard to_bb = (1ULL << move.to);
     Color color_to_move = position.color_to_move;
-    Square king_square = Square(bit_scan_forward(position.pieces[color_to_move][KING]));
-    Bitboard attacking_pieces = attacked_by(position, Square(bit_scan_forward(position.pieces[color_to_move][KING])), color_to_move ^ 1);
-    
-    if (!attacking_pieces)
+    Color enemy = Color(color_to_move ^ 1);
+    const Bitboard (&keys)[6][64] = ZOBRIST.pieces[color_to_move];
+
+    Bitboard from_to_bb = from_bb ^ to_bb;
+
+    position.pieces[color_to_move][move.piece_type] ^= from_to_bb;
+    position.hash ^= keys[move.piece_type][move.from] ^ keys[move.piece_type][move.to];
+    remove_piece_score(position, color_to_move, move.piece_type, move.from);
+    add_piece_score(position, color_to_move, move.piece_type, move.to);
+
+    if (move.is_castling)
     {
-        position.state = NORMAL;
-		return;
+        Square rook_from = to_bb > from_bb ? ROOKS_KINGSIDE[color_to_move] : ROOKS_QUEENSIDE[color_to_move];
+        Square rook_to = Square(to_bb > from_bb ? rook_from - 2 : rook_from + 3);
+        position.pieces[color_to_move][ROOK] ^= (1ULL << rook_from) | (1ULL << rook_to);
+        position.hash ^= keys[ROOK][rook_from] ^ keys[ROOK][rook_to];
+        remove_piece_score(position, color_to_move, ROOK, rook_from);
+        add_piece_score(position, color_to_move, ROOK, rook_to);
     }
-
-    if (legal_moves(position, king_square, nullptr))
+    else if (move.is_en_passant)
     {
-        position.state = CHECK;
-		return;
+        int captured_square = color_to_move == WHITE ? move.to - 8 : move.to + 8;
+        position.pieces[enemy][PAWN] &= ~(1ULL << captured_square);
+        position.hash ^= ZOBRIST.pieces[enemy][PAWN][captured_square];
+        remove_piece_score(position, enemy, PAWN, captured_square);
+    }
+    else if (move.captured_type != -1)
+    {
+        position.pieces[enemy][move.captured_type] &= ~to_bb;
+        position.hash ^= ZOBRIST.pieces[enemy][move.captured_type][move.to];
+        remove_piece_score(position, enemy, move.captured_type, move.to);
     }
 
-    
-    if (attacking_pieces & (attacking_pieces - 1))
+    if (move.promotion != -1)
     {
-        position.state = CHECKMATE;
-		return;
+        position.pieces[color_to_move][PAWN] &= ~to_bb;
+        position.pieces[color_to_move][move.promotion] |= to_bb;
+        position.hash ^= keys[PAWN][move.to] ^ keys[move.promotion][move.to];
+        remove_piece_score(position, color_to_move, PAWN, move.to);
+        add_piece_score(position, color_to_move, move.promotion, move.to);
     }
 
-	int attacker_square = bit_scan_forward(attacking_pieces);
+    if (position.en_passant != -1)
+        position.hash ^= ZOBRIST.en_passant[position.en_passant % 8];
+    position.en_passant = -1;
 
-    if (attacking_pieces & position.pieces[color_to_move ^ 1][KNIGHT])
+    // Only a double push next to an enemy pawn leaves an en passant square behind
+    if (move.piece_type == PAWN && (move.to - move.from == 16 || move.from - move.to == 16))
     {
-		Bitboard defenders = attacked_by(position, Square(attacker_square), color_to_move);
-
-        while (defenders)
+        int ep_square = (move.from + move.to) / 2;
+        if (pawn_attacks(Square(ep_square), color_to_move) & position.pieces[enemy][PAWN])
         {
-            Square defender_square = Square(bit_scan_forward(defenders));
-            Bitboard defend_moves = legal_moves(position, defender_square, nullptr);
-            if (defend_moves & attacking_pieces)
-            {
-                position.state = CHECK;
-                return;
-            }
-			defenders &= defenders - 1;
+            position.en_passant = ep_square;
+            position.hash ^= ZOBRIST.en_passant[ep_square % 8];
         }
-
-		position.state = CHECKMATE;
-		return;
     }
 
-    Bitboard ray = 0ULL;
-    for (int dir = NORTHWEST; dir <= WEST && !(ray & attacking_pieces); ++dir)
-        ray = get_ray_attacks(position.all_occupancy, Direction(dir), king_square);
-        
-    Square intercept_square;
-    while (ray)
-    {
-        intercept_square = Square(bit_scan_forward(ray));
-        if (attacked_by(position, intercept_square, color_to_move) & ~(position.pieces[color_to_move][PAWN] | position.pieces[color_to_move][KING]))
-        {
-            position.state = CHECK;
-            return;
-		}
-        ray &= ray - 1;
-    }
+    position.halfmove_clock = (move.piece_type == PAWN || move.captured_type != -1) ? 0 : position.halfmove_clock + 1;
+    if (color_to_move == BLACK)
+        position.fullmove_number++;
 
-	position.state = CHECKMATE;
+    update_occupancies(position);
+
+    position.color_to_move = enemy;
+    position.hash ^= ZOBRIST.side;
 }
 
 void test_move(Move& move, Position& position)
 {
-    Bitboard from_bb = (1ULL << move.from);
-    Bitboard to_bb = (1ULL << move.to);
-    Color color_to_move = position.color_to_move;
-
     move.is_castling = move.piece_type == KING && (move.to - move.from == 2 || move.to - move.from == -2);
 
-    //if (final_square_bb & ~current_position.empty)
-    //{
-    //	for (dest_type = nPawn; (dest_type <= nKing) && !(current_position.occupancy[dest_type] & final_square_bb); dest_type++);
-    //	current_position.occupancy[!color_to_move] &= ~final_square_bb;
-    //	current_position.occupancy[dest_type] &= ~final_square_bb;
-    //	position_history_3fold.clear();
-    //}
-
-    Bitboard from_to_bb = from_bb ^ to_bb;
+    move_pieces(move, position);
+}
 
-    position.pieces[color_to_move][move.piece_type] ^= from_to_bb;
+void make_move(const Move& move, Position& position)
+{
+    do_move(move, position);
+    update_game_state(position);
+}
 
-    if (move.is_castling)
-    {
-        position.pieces[color_to_move][ROOK] ^= (to_bb > from_bb ? (Bitboard(0B101) << (ROOKS_KINGSIDE[color_to_move] - 2) ) : (Bitboard(0B1001) << (ROOKS_QUEENSIDE[color_to_move])));
-        update_occupancies(position);
-    }
-    else
-    {
-        if (move.captured_type != -1)
-            position.pieces[color_to_move ^ 1][move.captured_type] &= ~to_bb;
-        update_occupancies(position);
-    }
+void do_move(const Move& move, Position& position)
+{
+    move_pieces(move, position);
+    update_castle_rights(position, move);
+}
 
-    position.color_to_move = Color(color_to_move ^ 1);
+void do_move(const Move& move, Position& position, UndoInfo& undo)
+{
+    undo.hash = position.hash;
+    undo.psq[0] = position.psq[0];
+    undo.psq[1] = position.psq[1];
+    undo.captured_type = move.captured_type;
+    undo.en_passant = position.en_passant;
+    undo.halfmove_clock = position.halfmove_clock;
+    undo.castling_rights[WHITE] = position.castling_rights[WHITE];
+    undo.castling_rights[BLACK] = position.castling_rights[BLACK];
+    undo.state = position.state;
+
+    do_move(move, position);
 }
 
-void make_move(const Move& move, Position& position)
+void unmake_move(const Move& move, const UndoInfo& undo, Position& position)
 {
     Bitboard from_bb = (1ULL << move.from);
     Bitboard to_bb = (1ULL << move.to);
-    Color color_to_move = position.color_to_move;
-
-    //if (final_square_bb & ~current_position.empty)
-    //{
-    //	for (dest_type = nPawn; (dest_type <= nKing) && !(current_position.occupancy[dest_type] & final_square_bb); dest_type++);
-    //	current_position.occupancy[!color_to_move] &= ~final_square_bb;
-    //	current_position.occupancy[dest_type] &= ~final_square_bb;
-    //	position_history_3fold.clear();
-    //}
+    Color color = Color(position.color_to_move ^ 1);
+    Color enemy = position.color_to_move;
 
-    Bitboard from_to_bb = from_bb ^ to_bb;
+    if (move.promotion != -1)
+    {
+        position.pieces[color][move.promotion] &= ~to_bb;
+        position.pieces[color][PAWN] |= to_bb;
+    }
 
-    position.pieces[color_to_move][move.piece_type] ^= from_to_bb;
+    position.pieces[color][move.piece_type] ^= from_bb ^ to_bb;
 
     if (move.is_castling)
-        position.pieces[color_to_move][ROOK] ^= (to_bb > from_bb ? (Bitboard(0B101) << (ROOKS_KINGSIDE[color_to_move] - 2) ) : (Bitboard(0B1001) << (ROOKS_QUEENSIDE[color_to_move])));
-    else if (move.captured_type != -1)
-        position.pieces[color_to_move ^ 1][move.captured_type] &= ~to_bb;
+    {
+        Square rook_from = to_bb > from_bb ? ROOKS_KINGSIDE[color] : ROOKS_QUEENSIDE[color];
+        Square rook_to = Square(to_bb > from_bb ? rook_from - 2 : rook_from + 3);
+        position.pieces[color][ROOK] ^= (1ULL << rook_from) | (1ULL << rook_to);
+    }
+    else if (move.is_en_passant)
+        position.pieces[enemy][PAWN] |= color == WHITE ? to_bb >> 8 : to_bb << 8;
+    else if (undo.captured_type != -1)
+        position.pieces[enemy][undo.captured_type] |= to_bb;
 
-    update_castle_rights(position, move);
     update_occupancies(position);
 
-    position.color_to_move = Color(color_to_move ^ 1);
-
-    update_game_state(position);
+    position.color_to_move = color;
+    position.hash = undo.hash;
+    position.psq[0] = undo.psq[0];
+    position.psq[1] = undo.psq[1];
+    position.en_passant = undo.en_passant;
+    position.halfmove_clock = undo.halfmove_clock;
+    position.castling_rights[WHITE] = undo.castling_rights[WHITE];
+    position.castling_rights[BLACK] = undo.castling_rights[BLACK];
+    position.state = undo.state;
+    if (color == BLACK)
+        position.fullmove_number--;
 }
-
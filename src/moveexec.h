@@ -3,8 +3,25 @@
 
 #include "position.h"
 
+// State of a position that cannot be recomputed when a move is taken back
+struct UndoInfo
+{
+    Bitboard hash;
+    int psq[2];
+    int captured_type;
+    int en_passant;
+    int halfmove_clock;
+    CastlingRights castling_rights[2];
+    GameState state;
+};
+
 void update_game_state(Position& position);
 void test_move(Move& move, Position& position);
 void make_move(const Move& move, Position& position);
+// make_move without the game state update, for search and perft where checkmate is found by generating moves
+void do_move(const Move& move, Position& position);
+// Make/unmake pair for copy-free search and perft. do_move records in undo what unmake_move needs to restore the position
+void do_move(const Move& move, Position& position, UndoInfo& undo);
+void unmake_move(const Move& move, const UndoInfo& undo, Position& position);
 
 #endif // MOVEEXEC_H
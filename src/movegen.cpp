@@ -1,59 +1,86 @@
 
 #include "movegen.h"
+#include "cpu.h"
 #include "moveexec.h"
 
-const int DIRECTION_OFFSETS[8][2]
+namespace
 {
-    { -1, 1},
-    { 0, 1 },
-    { 1, 1 },
-    { 1, 0 },
-    { 1, -1},
-    { 0, -1},
-    { -1, -1 },
-    { -1, 0 },
-};
+    constexpr int KNIGHT_OFFSETS[8][2] { { 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 } };
+    // [color][capture direction]
+    constexpr int PAWN_OFFSETS[2][2][2] { { { -1, 1 }, { 1, 1 } }, { { -1, -1 }, { 1, -1 } } };
 
-Bitboard ray_attacks[8][64];
+    constexpr bool on_board(int file, int rank) { return file >= 0 && file < 8 && rank >= 0 && rank < 8; }
 
-// Pre-computes the attacking rays for the sliding pieces. A middle-ground approach between a per-move calculation and a magic bitboard solution.
-void init_rays()
-{
-    for (int sq = 0; sq < 64; ++sq) {
-        int rank = sq / 8;
-        int file = sq % 8;
+    // Squares one step away from sq in each of the given (file, rank) offsets
+    template <int N>
+    constexpr Bitboard step_attacks(int sq, const int (&offsets)[N][2])
+    {
+        Bitboard attacks = 0ULL;
+        for (int i = 0; i < N; ++i)
+        {
+            int f = sq % 8 + offsets[i][0];
+            int r = sq / 8 + offsets[i][1];
+            if (on_board(f, r))
+                attacks |= 1ULL << (r * 8 + f);
+        }
+        return attacks;
+    }
 
-        for (int dir = 0; dir < 8; ++dir) {
-            int dr = DIRECTION_OFFSETS[dir][1];
-            int df = DIRECTION_OFFSETS[dir][0];
+    constexpr AttackTables generate_attack_tables()
+    {
+        AttackTables tables {};
 
-            int r = rank + dr;
-            int f = file + df;
-            Bitboard ray = 0ULL;
+        for (int sq = 0; sq < 64; ++sq)
+        {
+            tables.knight[sq] = step_attacks(sq, KNIGHT_OFFSETS);
+            tables.king[sq] = step_attacks(sq, DIRECTION_OFFSETS);
+            tables.pawn[WHITE][sq] = step_attacks(sq, PAWN_OFFSETS[WHITE]);
+            tables.pawn[BLACK][sq] = step_attacks(sq, PAWN_OFFSETS[BLACK]);
+
+            for (int dir = 0; dir < 8; ++dir)
+            {
+                int df = DIRECTION_OFFSETS[dir][0];
+                int dr = DIRECTION_OFFSETS[dir][1];
+
+                for (int f = sq % 8 + df, r = sq / 8 + dr; on_board(f, r); f += df, r += dr)
+                    tables.ray[dir][sq] |= 1ULL << (r * 8 + f);
+            }
+        }
 
-            while (r >= 0 && r < 8 && f >= 0 && f < 8) {
-                ray |= (1ULL << (r * 8 + f));
-                r += dr;
-                f += df;
+        // Walking each ray, the squares already passed are the ones between the origin and the current square
+        for (int sq = 0; sq < 64; ++sq)
+        {
+            for (int dir = 0; dir < 8; ++dir)
+            {
+                int df = DIRECTION_OFFSETS[dir][0];
+                int dr = DIRECTION_OFFSETS[dir][1];
+                Bitboard line = tables.ray[dir][sq] | tables.ray[(dir + 4) % 8][sq] | (1ULL << sq);
+                Bitboard passed = 0ULL;
+
+                for (int f = sq % 8 + df, r = sq / 8 + dr; on_board(f, r); f += df, r += dr)
+                {
+                    int to = r * 8 + f;
+                    tables.between[sq][to] = passed;
+                    tables.line[sq][to] = line;
+                    passed |= 1ULL << to;
+                }
             }
-            ray_attacks[dir][sq] = ray;
         }
+
+        return tables;
     }
 }
 
-Bitboard pawn_attacks(Bitboard squares, int color)
-{
-    return color == BLACK ? south_east_one(squares) | south_west_one(squares) : north_east_one(squares) | north_west_one(squares);
-}
+constexpr AttackTables ATTACKS = generate_attack_tables();
 
 Bitboard get_ray_attacks(Bitboard occupied, Direction dir, Square square)
 {
-    Bitboard attacks = ray_attacks[dir][square];
+    Bitboard attacks = ATTACKS.ray[dir][square];
     Bitboard blockers = attacks & occupied;
     if (blockers)
     {
         square = Square(dir < 4 ? bit_scan_forward(blockers) : bit_scan_reverse(blockers));
-        attacks ^= ray_attacks[dir][square];
+        attacks ^= ATTACKS.ray[dir][square];
     }
     return attacks;
 }
@@ -78,73 +105,118 @@ Bitboard rank_attacks(Bitboard occupancy, Square square)
     return get_ray_attacks(occupancy, EAST, square) | get_ray_attacks(occupancy, WEST, square);
 }
 
-Bitboard rook_attacks(Bitboard occupancy, Square square)
+Bitboard ray_rook_attacks(Bitboard occupancy, Square square)
 {
     return rank_attacks(occupancy, square) | file_attacks(occupancy, square);
 }
 
-Bitboard bishop_attacks(Bitboard occupancy, Square square)
+Bitboard ray_bishop_attacks(Bitboard occupancy, Square square)
 {
     return diagonal_attacks(occupancy, square) | anti_diagonal_attacks(occupancy, square);
 }
 
-Bitboard queen_attacks(Bitboard occupancy, Square square)
-{
-    return rook_attacks(occupancy, square) | bishop_attacks(occupancy, square);
-}
-
-Bitboard knight_attacks(Bitboard knights) {
-    Bitboard west, east, attacks;
-    east = east_one(knights);
-    west = west_one(knights);
-    attacks = (east | west) << 16;
-    attacks |= (east | west) >> 16;
-    east = east_one(east);
-    west = west_one(west);
-    attacks |= (east | west) << 8;
-    attacks |= (east | west) >> 8;
-    return attacks;
-}
-
-Bitboard king_attacks(Bitboard king) {
-    Bitboard attacks = east_one(king) | west_one(king);
-    king |= attacks;
-    attacks |= north_one(king) | south_one(king);
-    return attacks;
-}
-
 Bitboard knight_moves(const Position& position, Square square, int color)
 {
-    Bitboard attacks = knight_attacks(1ULL << square);
+    Bitboard attacks = knight_attacks(square);
 
     return attacks & ~position.occupancy[color];
 }
 
 Bitboard king_moves(const Position& position, Square square, int color)
 {
-    Bitboard attacks = king_attacks(1ULL << square);
+    Bitboard attacks = king_attacks(square);
 
     return (attacks & ~position.occupancy[color]) | castling_moves(position, Color(color));
 }
 
-Bitboard single_push(const Bitboard pawns, Bitboard empty, int color)
+/*
+    Color templates. Instantiated once per side so that shift directions, rank masks and castling squares are
+    compile-time constants instead of lookups and branches on a runtime color
+*/
+namespace
 {
-    return _rotl64(pawns, 8 - (color << 4)) & empty;
-}
+    constexpr Bitboard rank_bb(int rank) { return 0xFFULL << (8 * rank); }
+    constexpr Bitboard file_bb(int file) { return 0x0101010101010101ULL << file; }
 
-Bitboard double_push(const Bitboard pawns, Bitboard empty, int color)
-{
-    return _rotl64(pawns, 16 - (color << 5)) & empty;
+    // Rank as seen from Us, so rank 0 is the back rank of either side
+    template <Color Us>
+    constexpr Bitboard relative_rank_bb(int rank) { return rank_bb(Us == WHITE ? rank : 7 - rank); }
+
+    template <Color Us>
+    constexpr Square relative_square(Square square) { return Square(Us == WHITE ? square : square ^ 56); }
+
+    template <Color Us>
+    constexpr Bitboard push_up(Bitboard bitboard) { return Us == WHITE ? bitboard << 8 : bitboard >> 8; }
+
+    // Pawn captures towards the a-file and the h-file, with the wrapping files masked off
+    template <Color Us>
+    constexpr Bitboard capture_west(Bitboard pawns) { return Us == WHITE ? (pawns & ~file_bb(0)) << 7 : (pawns & ~file_bb(0)) >> 9; }
+    template <Color Us>
+    constexpr Bitboard capture_east(Bitboard pawns) { return Us == WHITE ? (pawns & ~file_bb(7)) << 9 : (pawns & ~file_bb(7)) >> 7; }
+
+    template <Color Us>
+    constexpr int UP = Us == WHITE ? 8 : -8;
+
+    template <Color Them>
+    bool is_attacked(const Position& position, Square square)
+    {
+        const Bitboard* pieces = position.pieces[Them];
+
+        return (pawn_attacks(square, Them ^ 1) & pieces[PAWN]) ||
+               (knight_attacks(square) & pieces[KNIGHT]) ||
+               (bishop_attacks(position.all_occupancy, square) & (pieces[BISHOP] | pieces[QUEEN])) ||
+               (rook_attacks(position.all_occupancy, square) & (pieces[ROOK] | pieces[QUEEN])) ||
+               (king_attacks(square) & pieces[KING]);
+    }
+
+    template <Color Them>
+    Bitboard attacked_by(const Position& position, Square square, Bitboard occupancy)
+    {
+        const Bitboard* pieces = position.pieces[Them];
+
+        return (pawn_attacks(square, Them ^ 1) & pieces[PAWN]) |
+               (knight_attacks(square) & pieces[KNIGHT]) |
+               (bishop_attacks(occupancy, square) & (pieces[BISHOP] | pieces[QUEEN])) |
+               (rook_attacks(occupancy, square) & (pieces[ROOK] | pieces[QUEEN])) |
+               (king_attacks(square) & pieces[KING]);
+    }
+
+    template <Color Us>
+    Bitboard pawn_moves(const Position& position, Square square)
+    {
+        Bitboard pawns = position.pieces[Us][PAWN] & (1ULL << square);
+        Bitboard push = push_up<Us>(pawns) & position.empty;
+        Bitboard double_push = push_up<Us>(push & relative_rank_bb<Us>(2)) & position.empty;
+
+        return push | double_push | (pawn_attacks(square, Us) & position.occupancy[Us ^ 1]);
+    }
+
+    // Castling destinations of the king, assuming it is not in check
+    template <Color Us>
+    Bitboard castling_moves(const Position& position)
+    {
+        constexpr Color Them = Color(Us ^ 1);
+        constexpr Square F = relative_square<Us>(f1), G = relative_square<Us>(g1);
+        constexpr Square D = relative_square<Us>(d1), C = relative_square<Us>(c1), B = relative_square<Us>(b1);
+
+        Bitboard occupancy = position.all_occupancy;
+        Bitboard result = 0ULL;
+
+        if ((position.castling_rights[Us] & KS) && !(occupancy & ((1ULL << F) | (1ULL << G))) &&
+            !is_attacked<Them>(position, F) && !is_attacked<Them>(position, G))
+            result |= 1ULL << G;
+
+        if ((position.castling_rights[Us] & QS) && !(occupancy & ((1ULL << D) | (1ULL << C) | (1ULL << B))) &&
+            !is_attacked<Them>(position, D) && !is_attacked<Them>(position, C))
+            result |= 1ULL << C;
+
+        return result;
+    }
 }
 
-Bitboard pawn_moves(const Position& position, Square squares, int color)
+Bitboard pawn_moves(const Position& position, Square square, int color)
 {
-    Bitboard sq_bb = 1ULL << squares;
-    Bitboard pawns = position.pieces[color][PAWN] & sq_bb;
-    Bitboard not_moved = pawns & (color == WHITE ? SECOND_RANK : SEVENTH_RANK);
-    Bitboard attacks = pawn_attacks(sq_bb, color) & position.occupancy[!color];
-
-    return single_push(pawns, position.empty, color) | double_push(not_moved, position.empty, color) | attacks;
+    return color == WHITE ? pawn_moves<WHITE>(position, square) : pawn_moves<BLACK>(position, square);
 }
 
 Bitboard rook_moves(const Position& position, Square square, int color)
@@ -166,30 +238,7 @@ Bitboard castling_moves(const Position& position, Color color)
 {
     if (is_king_in_check(position, color ^ 1)) return 0ULL;
 
-    Bitboard occ = position.all_occupancy;
-    Bitboard result = 0ULL;
-
-    if (position.castling_rights[color] & KS)
-    {
-        if (!(occ & KSIDE_BLOCK_MASK[color]) &&
-            !is_attacked(position, KSIDE_PASS_SQUARES[color][0], color ^ 1) &&
-            !is_attacked(position, KSIDE_PASS_SQUARES[color][1], color ^ 1))
-        {
-            result |= (1ULL << KSIDE_KING_DEST[color]);
-        }
-    }
-
-    if (position.castling_rights[color] & QS)
-    {
-        if (!(occ & QSIDE_BLOCK_MASK[color]) &&
-            !is_attacked(position, QSIDE_PASS_SQUARES[color][0], color ^ 1) &&
-            !is_attacked(position, QSIDE_PASS_SQUARES[color][1], color ^ 1))
-        {
-            result |= (1ULL << QSIDE_KING_DEST[color]);
-        }
-    }
-
-    return result;
+    return color == WHITE ? castling_moves<WHITE>(position) : castling_moves<BLACK>(position);
 }
 
 Bitboard moves(Square square, const Position& position)
@@ -229,52 +278,335 @@ Bitboard moves(Square square, const Position& position)
     return moves;
 }
 
-Bitboard legal_moves(const Position& position, Square square, std::vector<Move>* legal_moves_list)
+namespace
 {
-    if (legal_moves_list) legal_moves_list->clear();
+    template <Color Us>
+    CheckInfo check_info(const Position& position)
+    {
+        constexpr Color Them = Color(Us ^ 1);
+        const Bitboard* enemy = position.pieces[Them];
+
+        CheckInfo info;
+        info.king_square = Square(bit_scan_forward(position.pieces[Us][KING]));
+        info.checkers = attacked_by<Them>(position, info.king_square, position.all_occupancy);
+        info.pinned = 0ULL;
+
+        if (!info.checkers)
+            info.check_mask = ~0ULL;
+        else if (info.checkers & (info.checkers - 1))
+            info.check_mask = 0ULL;
+        else
+            info.check_mask = info.checkers | ATTACKS.between[info.king_square][bit_scan_forward(info.checkers)];
+
+        // Enemy sliders that would attack the king if our own pieces were not in the way
+        Bitboard snipers = (rook_attacks(position.occupancy[Them], info.king_square) & (enemy[ROOK] | enemy[QUEEN])) |
+                           (bishop_attacks(position.occupancy[Them], info.king_square) & (enemy[BISHOP] | enemy[QUEEN]));
+
+        while (snipers)
+        {
+            Square sniper_square = Square(bit_scan_forward(snipers));
+            snipers &= snipers - 1;
 
-    if (~position.all_occupancy & (1ULL << square)) return 0ULL;
+            Bitboard blockers = ATTACKS.between[info.king_square][sniper_square] & position.all_occupancy;
+            if (blockers && !(blockers & (blockers - 1)))
+                info.pinned |= blockers & position.occupancy[Us];
+        }
 
-    Bitboard peusdo_legal_moves = moves(square, position);
-    Bitboard legal_moves = 0ULL;
+        return info;
+    }
+}
 
-    while (peusdo_legal_moves)
+HOT_DISPATCH CheckInfo check_info(const Position& position)
+{
+    return position.color_to_move == WHITE ? check_info<WHITE>(position) : check_info<BLACK>(position);
+}
+
+namespace
+{
+    enum GenType
     {
-        Square to_square = (Square)bit_scan_forward(peusdo_legal_moves);
-        peusdo_legal_moves &= peusdo_legal_moves - 1;
-        Position new_position = position;
-        // Make the move on a copy of the position
-        Bitboard from_bb = 1ULL << square;
-        Bitboard to_bb = 1ULL << to_square;
-        int piece_type;
-        int captured_type = -1;
-        for (piece_type = PAWN; piece_type <= KING && !(from_bb & new_position.pieces[new_position.color_to_move][piece_type]); ++piece_type);
-
-        if (to_bb & new_position.occupancy[new_position.color_to_move ^ 1])
-        {
-            for (captured_type = PAWN; captured_type <= KING && !(to_bb & new_position.pieces[new_position.color_to_move ^ 1][captured_type]); ++captured_type);
-        }
+        GEN_CAPTURES = 0x01,
+        GEN_QUIETS   = 0x02,
+        GEN_ALL      = GEN_CAPTURES | GEN_QUIETS
+    };
+
+    // Queen first so callers picking the first matching from/to pair promote to a queen
+    const PieceType PROMOTION_TYPES[4] = { QUEEN, KNIGHT, ROOK, BISHOP };
+
+    int piece_type_on(const Position& position, int color, Square square)
+    {
+        Bitboard sq_bb = 1ULL << square;
+        int type;
+        for (type = PAWN; type <= KING && !(sq_bb & position.pieces[color][type]); ++type);
+        return type <= KING ? type : -1;
+    }
+
+    template <PieceType Type>
+    Bitboard piece_attacks(Square square, Bitboard occupancy)
+    {
+        if constexpr (Type == ROOK)
+            return rook_attacks(occupancy, square);
+        else if constexpr (Type == KNIGHT)
+            return knight_attacks(square);
+        else if constexpr (Type == BISHOP)
+            return bishop_attacks(occupancy, square);
+        else if constexpr (Type == QUEEN)
+            return queen_attacks(occupancy, square);
+        else
+            return king_attacks(square);
+    }
 
+    Move create_move(Square from, Square to, int piece_type, Color color, int captured_type, int promotion = -1)
+    {
         Move move;
-        move.from = square;
-        move.to = to_square;
-        move.piece_type = (PieceType)piece_type;
-        move.color = new_position.color_to_move;
+        move.from = from;
+        move.to = to;
+        move.piece_type = PieceType(piece_type);
+        move.color = color;
         move.captured_type = captured_type;
+        move.promotion = promotion;
+        return move;
+    }
 
+    // Copy-make fallback for the cases the masks do not cover. Keeps the move only if it does not leave the mover's king in check
+    void add_if_legal(const Position& position, Move move, MoveList& list)
+    {
+        Position new_position = position;
         test_move(move, new_position);
 
         if (!is_king_in_check(new_position, new_position.color_to_move))
+            list.push(move);
+    }
+
+    // Targets must already be restricted to legal destinations
+    template <Color Us>
+    void add_moves(const Position& position, Square from, int piece_type, Bitboard targets, MoveList& list)
+    {
+        while (targets)
+        {
+            Square to = Square(bit_scan_forward(targets));
+            targets &= targets - 1;
+
+            list.push(create_move(from, to, piece_type, Us, piece_type_on(position, Us ^ 1, to)));
+        }
+    }
+
+    // Pawn moves landing on targets, each made from the square offset behind it
+    template <Color Us, bool Capture>
+    void add_pawn_moves(const Position& position, Bitboard targets, int offset, MoveList& list)
+    {
+        while (targets)
         {
-            legal_moves |= to_bb;
-            if (legal_moves_list)
-                legal_moves_list->push_back(move);
+            Square to = Square(bit_scan_forward(targets));
+            targets &= targets - 1;
+
+            Square from = Square(to - offset);
+            int captured_type = Capture ? piece_type_on(position, Us ^ 1, to) : -1;
+
+            if ((1ULL << to) & relative_rank_bb<Us>(7))
+            {
+                for (PieceType promotion : PROMOTION_TYPES)
+                    list.push(create_move(from, to, PAWN, Us, captured_type, promotion));
+            }
+            else
+                list.push(create_move(from, to, PAWN, Us, captured_type));
         }
     }
 
+    // Moves of a set of pawns, shifted all at once. Destinations are restricted to allowed
+    template <Color Us, int Gen>
+    void generate_pawns(const Position& position, Bitboard pawns, Bitboard allowed, MoveList& list)
+    {
+        constexpr Bitboard PROMOTION_RANK = relative_rank_bb<Us>(7);
+
+        Bitboard enemies = position.occupancy[Us ^ 1] & allowed;
+        Bitboard push = push_up<Us>(pawns) & position.empty;
+
+        // Promotions count as captures even when they do not take anything
+        if (Gen & GEN_CAPTURES)
+        {
+            add_pawn_moves<Us, true>(position, capture_west<Us>(pawns) & enemies, UP<Us> - 1, list);
+            add_pawn_moves<Us, true>(position, capture_east<Us>(pawns) & enemies, UP<Us> + 1, list);
+            add_pawn_moves<Us, false>(position, push & PROMOTION_RANK & allowed, UP<Us>, list);
+        }
+
+        if (Gen & GEN_QUIETS)
+        {
+            Bitboard double_push = push_up<Us>(push & relative_rank_bb<Us>(2)) & position.empty;
+
+            add_pawn_moves<Us, false>(position, push & ~PROMOTION_RANK & allowed, UP<Us>, list);
+            add_pawn_moves<Us, false>(position, double_push & allowed, 2 * UP<Us>, list);
+        }
+    }
+
+    template <Color Us, PieceType Type>
+    void generate_pieces(const Position& position, const CheckInfo& info, Bitboard from_mask, Bitboard targets, MoveList& list)
+    {
+        Bitboard pieces = position.pieces[Us][Type] & from_mask;
+        while (pieces)
+        {
+            Square from = Square(bit_scan_forward(pieces));
+            pieces &= pieces - 1;
+
+            Bitboard piece_targets = piece_attacks<Type>(from, position.all_occupancy) & targets;
+            if ((1ULL << from) & info.pinned)
+                piece_targets &= ATTACKS.line[info.king_square][from];
+
+            add_moves<Us>(position, from, Type, piece_targets, list);
+        }
+    }
+
+    // Generates the legal moves of the pieces on from_mask. Pinned pieces stay on their pin ray and, when in check,
+    // every non-king move must capture the checker or block the check
+    template <Color Us, int Gen>
+    void generate(const Position& position, Bitboard from_mask, MoveList& list)
+    {
+        constexpr Color Them = Color(Us ^ 1);
+        CheckInfo info = check_info<Us>(position);
+
+        Bitboard targets = 0ULL;
+        if (Gen & GEN_CAPTURES) targets |= position.occupancy[Them];
+        if (Gen & GEN_QUIETS) targets |= position.empty;
+
+        Bitboard king_bb = position.pieces[Us][KING] & from_mask;
+        if (king_bb)
+        {
+            // The king is removed from the occupancy so it cannot hide behind itself on a slider ray
+            Bitboard king_targets = king_attacks(info.king_square) & targets;
+            Bitboard occupancy = position.all_occupancy ^ king_bb;
+            Bitboard safe = 0ULL;
+
+            while (king_targets)
+            {
+                Square to = Square(bit_scan_forward(king_targets));
+                king_targets &= king_targets - 1;
+
+                if (!attacked_by<Them>(position, to, occupancy))
+                    safe |= 1ULL << to;
+            }
+            add_moves<Us>(position, info.king_square, KING, safe, list);
+
+            if ((Gen & GEN_QUIETS) && !info.checkers)
+            {
+                Bitboard castles = castling_moves<Us>(position);
+
+                while (castles)
+                {
+                    Square to = Square(bit_scan_forward(castles));
+                    castles &= castles - 1;
+
+                    Move move = create_move(info.king_square, to, KING, Us, -1);
+                    move.is_castling = true;
+                    list.push(move);
+                }
+            }
+        }
+
+        // In double check only the king can move
+        if (!info.check_mask)
+            return;
+
+        targets &= info.check_mask;
+
+        // Unpinned pawns are generated together, pinned ones one at a time along their pin line
+        Bitboard pawns = position.pieces[Us][PAWN] & from_mask;
+        generate_pawns<Us, Gen>(position, pawns & ~info.pinned, info.check_mask, list);
+
+        Bitboard pinned_pawns = pawns & info.pinned;
+        while (pinned_pawns)
+        {
+            Square from = Square(bit_scan_forward(pinned_pawns));
+            pinned_pawns &= pinned_pawns - 1;
+
+            generate_pawns<Us, Gen>(position, 1ULL << from, info.check_mask & ATTACKS.line[info.king_square][from], list);
+        }
+
+        // En passant removes two pawns from the same rank, which the pin masks do not model, so it is tested by making it
+        if ((Gen & GEN_CAPTURES) && position.en_passant != -1)
+        {
+            Square to = Square(position.en_passant);
+            Bitboard capturers = pawn_attacks(to, Them) & pawns;
+
+            while (capturers)
+            {
+                Square from = Square(bit_scan_forward(capturers));
+                capturers &= capturers - 1;
+
+                Move move = create_move(from, to, PAWN, Us, PAWN);
+                move.is_en_passant = true;
+                add_if_legal(position, move, list);
+            }
+        }
+
+        generate_pieces<Us, ROOK>(position, info, from_mask, targets, list);
+        generate_pieces<Us, KNIGHT>(position, info, from_mask, targets, list);
+        generate_pieces<Us, BISHOP>(position, info, from_mask, targets, list);
+        generate_pieces<Us, QUEEN>(position, info, from_mask, targets, list);
+    }
+
+    template <int Gen>
+    HOT_DISPATCH void generate(const Position& position, Bitboard from_mask, MoveList& list)
+    {
+        if (position.color_to_move == WHITE)
+            generate<WHITE, Gen>(position, from_mask, list);
+        else
+            generate<BLACK, Gen>(position, from_mask, list);
+    }
+}
+
+Bitboard legal_moves(const Position& position, Square square, std::vector<Move>* legal_moves_list)
+{
+    if (legal_moves_list) legal_moves_list->clear();
+
+    MoveList list;
+    generate<GEN_ALL>(position, 1ULL << square, list);
+
+    Bitboard legal_moves = 0ULL;
+
+    for (const Move& move : list)
+    {
+        legal_moves |= 1ULL << move.to;
+        if (legal_moves_list)
+            legal_moves_list->push_back(move);
+    }
+
     return legal_moves;
 }
 
+bool find_legal_move(const Position& position, const Move& move, Move& legal)
+{
+    if (move.from == move.to || !((1ULL << move.from) & position.occupancy[position.color_to_move]))
+        return false;
+
+    MoveList list;
+    generate<GEN_ALL>(position, 1ULL << move.from, list);
+
+    for (const Move& candidate : list)
+    {
+        if (candidate == move)
+        {
+            legal = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void generate_legal(const Position& position, MoveList& list)
+{
+    generate<GEN_ALL>(position, ~0ULL, list);
+}
+
+void generate_captures(const Position& position, MoveList& list)
+{
+    generate<GEN_CAPTURES>(position, ~0ULL, list);
+}
+
+void generate_quiets(const Position& position, MoveList& list)
+{
+    generate<GEN_QUIETS>(position, ~0ULL, list);
+}
+
 bool is_valid_square(const Position& position, Square square)
 {
     Bitboard bb = (1ULL << square);
@@ -286,41 +618,19 @@ bool is_friendly_square(const Position& position, Square square)
     return bool((1ULL << square) & position.occupancy[position.color_to_move]);
 }
 
-bool is_attacked(const Position& position, Square square, int attacking_color)
+HOT_DISPATCH bool is_attacked(const Position& position, Square square, int attacking_color)
 {
-    Bitboard sq_bb = 1ULL << square;
-    Bitboard pawns = position.pieces[attacking_color][PAWN];
-    if (pawn_attacks(sq_bb, attacking_color ^ 1) & pawns) return true;
-
-    Bitboard knights = position.pieces[attacking_color][KNIGHT];
-    if (knight_attacks(sq_bb) & knights) return true;
-
-    Bitboard bishops_queens = position.pieces[attacking_color][BISHOP] | position.pieces[attacking_color][QUEEN];
-    if (bishop_attacks(position.all_occupancy, square) & bishops_queens) return true;
-
-    Bitboard rooks_queens = position.pieces[attacking_color][ROOK] | position.pieces[attacking_color][QUEEN];
-    if (rook_attacks(position.all_occupancy, square) & rooks_queens) return true;
-
-    Bitboard king = position.pieces[attacking_color][KING];
-    if (king_attacks(sq_bb) & king) return true;
-
-    return false;
+    return attacking_color == WHITE ? is_attacked<WHITE>(position, square) : is_attacked<BLACK>(position, square);
 }
 
 Bitboard attacked_by(const Position& position, Square square, int attacking_color)
 {
-    Bitboard sq_bb = 1ULL << square;
-    Bitboard pawns = position.pieces[attacking_color][PAWN];
-    Bitboard knights = position.pieces[attacking_color][KNIGHT];
-    Bitboard bishops_queens = position.pieces[attacking_color][BISHOP] | position.pieces[attacking_color][QUEEN];
-    Bitboard rooks_queens = position.pieces[attacking_color][ROOK] | position.pieces[attacking_color][QUEEN];
-    Bitboard king = position.pieces[attacking_color][KING];
+    return attacked_by(position, square, attacking_color, position.all_occupancy);
+}
 
-    return pawn_attacks(sq_bb, attacking_color) & pawns |
-           knight_attacks(sq_bb) & knights |
-           bishop_attacks(position.all_occupancy, square) & bishops_queens |
-           rook_attacks(position.all_occupancy, square) & rooks_queens |
-           king_attacks(sq_bb) & king;
+HOT_DISPATCH Bitboard attacked_by(const Position& position, Square square, int attacking_color, Bitboard occupancy)
+{
+    return attacking_color == WHITE ? attacked_by<WHITE>(position, square, occupancy) : attacked_by<BLACK>(position, square, occupancy);
 }
 
 bool is_king_in_check(const Position& position, int attacking_color)
@@ -329,35 +639,103 @@ bool is_king_in_check(const Position& position, int attacking_color)
 }
 
 /*
-    Magic Bitboard implementation (WIP)
+    Magic Bitboard implementation
 */
 
-/*
-void ChessGame::init_magics(bool is_rook, U64 piece_table[], Magic magics[])
+Bitboard rook_table[0x19000];
+Bitboard bishop_table[0x1480];
+
+Magic rook_magics[64];
+Magic bishop_magics[64];
+
+namespace
 {
-    int size = 0;
-    U64 b = 0;
-    U64 occ[4096];
-    U64 ref[4096];
-    for (int sq = a1; sq <= h8; sq++)
+    // xorshift64* generator used to search for magic numbers. Seeded per rank so the search stays short and deterministic
+    struct MagicRng
     {
-        U64 edges_ex = (((fifth_rank | eighth_rank) & ~rank_mask(sq)) | ((a_file | h_file) & ~file_mask(sq)));
+        Bitboard state;
+
+        Bitboard rand64()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 2685821657736338717ULL;
+        }
+
+        // Magics with few set bits are found much faster
+        Bitboard sparse_rand() { return rand64() & rand64() & rand64(); }
+    };
 
-        Magic& m = magics[sq];
-        m.mask = (is_rook ? rook_mask_ex(sq) : bishop_mask_ex(sq)) & ~edges_ex;
-        m.shift = 64 - pop_count(m.mask);
-        m.attacks = sq == a1 ? piece_table : magics[sq - 1].attacks + size;
+    const Bitboard MAGIC_SEEDS[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
 
-        b = size = 0;
+    void init_magics(bool is_rook, Bitboard piece_table[], Magic magics[])
+    {
+        Bitboard occupancies[4096];
+        Bitboard reference[4096];
+        int epoch[4096] = {};
+        int attempt = 0;
+        int size = 0;
 
-        do
+        for (int sq = a1; sq <= h8; sq++)
         {
-            occ[size] = b;
-            ref[size] = is_rook ? rook_attack(sq, b) : bishop_attack(sq, b);
-            size++;
-            b = (b - m.mask) & m.mask;
-        } while (b);
+            Bitboard rank_bb = FIRST_RANK << (8 * (sq / 8));
+            Bitboard file_bb = A_FILE << (sq % 8);
+            // Edge squares never block a slider, so they are left out of the relevant occupancy
+            Bitboard edges = ((FIRST_RANK | EIGHT_RANK) & ~rank_bb) | ((A_FILE | H_FILE) & ~file_bb);
+
+            Magic& m = magics[sq];
+            m.mask = (is_rook ? ray_rook_attacks(0ULL, Square(sq)) : ray_bishop_attacks(0ULL, Square(sq))) & ~edges;
+            m.shift = 64 - pop_count(m.mask);
+            m.attacks = sq == a1 ? piece_table : magics[sq - 1].attacks + size;
+
+            // Carry-Rippler enumeration of every subset of the mask
+            Bitboard b = 0ULL;
+            size = 0;
+            do
+            {
+                occupancies[size] = b;
+                reference[size] = is_rook ? ray_rook_attacks(b, Square(sq)) : ray_bishop_attacks(b, Square(sq));
+#ifdef USE_PEXT
+                m.attacks[pext(b, m.mask)] = reference[size];
+#endif
+                size++;
+                b = (b - m.mask) & m.mask;
+            } while (b);
+
+#ifndef USE_PEXT
+            MagicRng rng { MAGIC_SEEDS[sq / 8] };
+
+            // Try random candidates until one maps every occupancy to a slot without a destructive collision
+            for (int i = 0; i < size; )
+            {
+                for (m.magic = 0; pop_count((m.magic * m.mask) >> 56) < 6; )
+                    m.magic = rng.sparse_rand();
+
+                for (++attempt, i = 0; i < size; ++i)
+                {
+                    unsigned index = m.index(occupancies[i]);
+
+                    if (epoch[index] < attempt)
+                    {
+                        epoch[index] = attempt;
+                        m.attacks[index] = reference[i];
+                    }
+                    else if (m.attacks[index] != reference[i])
+                        break;
+                }
+            }
+#endif
+        }
     }
+
+    // Filled while the program loads, before main runs, so the inline lookups of movegen.h never see an empty table.
+    // Nothing may look up slider attacks from a static initializer of another file
+    const bool magics_initialized = []
+    {
+        init_magics(true, rook_table, rook_magics);
+        init_magics(false, bishop_table, bishop_magics);
+        return true;
+    }();
 }
-*/
 
@@ -15,15 +15,35 @@ enum Direction {
     WEST		= 7,
 };
 
-// For initial pre-computation of ray_attacks
-extern const int DIRECTION_OFFSETS[8][2];
+// (file, rank) step of each direction
+constexpr int DIRECTION_OFFSETS[8][2]
+{
+    { -1, 1},
+    { 0, 1 },
+    { 1, 1 },
+    { 1, 0 },
+    { 1, -1},
+    { 0, -1},
+    { -1, -1 },
+    { -1, 0 },
+};
 
-// Pre-computed ray attacks for sliding pieces in all 8 directions
-extern Bitboard ray_attacks[8][64];
+// Attack and geometry tables. Generated at compile time, so they need no initialization and are safe to share between threads
+struct AttackTables
+{
+    // Rays for the sliding pieces in all 8 directions, [direction][square]
+    Bitboard ray[8][64];
+    // Squares strictly between two squares sharing a rank, file or diagonal (empty otherwise)
+    Bitboard between[64][64];
+    // Entire rank, file or diagonal through two aligned squares (empty otherwise)
+    Bitboard line[64][64];
+    Bitboard knight[64];
+    Bitboard king[64];
+    // Squares a pawn of [color] on [square] attacks
+    Bitboard pawn[2][64];
+};
 
-// Optimizatin Option: pre-compute with magic bitboards
-// Pre-computes the attacking rays for the sliding pieces. A middle-ground approach between a per-move calculation and a magic bitboard solution
-void init_rays();
+extern const AttackTables ATTACKS;
 
 inline Bitboard north_one(Bitboard bitboard) { return north_shift(bitboard, 1); }
 inline Bitboard north_east_one(Bitboard bitboard) { return north_east_shift(bitboard, 1) & ~A_FILE; }
@@ -34,27 +54,56 @@ inline Bitboard south_west_one(Bitboard bitboard) { return south_west_shift(bitb
 inline Bitboard west_one(Bitboard bitboard) { return west_shift(bitboard, 1) & ~H_FILE; }
 inline Bitboard north_west_one(Bitboard bitboard) { return north_west_shift(bitboard, 1) & ~H_FILE; }
 
-inline bool is_file_attack(Square square, Bitboard attack) { return attack & (ray_attacks[NORTH][square] | ray_attacks[SOUTH][square]); }
-inline bool is_rank_attack(Square square, Bitboard attack) { return attack & (ray_attacks[EAST][square] | ray_attacks[WEST][square]); }
-inline bool is_diag_attack(Square square, Bitboard attack) { return attack & (ray_attacks[NORTHEAST][square] | ray_attacks[SOUTHWEST][square]); }
-inline bool is_antidiag_attack(Square square, Bitboard attack) { return attack & (ray_attacks[SOUTHEAST][square] | ray_attacks[NORTHWEST][square]); }
+inline bool is_file_attack(Square square, Bitboard attack) { return attack & (ATTACKS.ray[NORTH][square] | ATTACKS.ray[SOUTH][square]); }
+inline bool is_rank_attack(Square square, Bitboard attack) { return attack & (ATTACKS.ray[EAST][square] | ATTACKS.ray[WEST][square]); }
+inline bool is_diag_attack(Square square, Bitboard attack) { return attack & (ATTACKS.ray[NORTHEAST][square] | ATTACKS.ray[SOUTHWEST][square]); }
+inline bool is_antidiag_attack(Square square, Bitboard attack) { return attack & (ATTACKS.ray[SOUTHEAST][square] | ATTACKS.ray[NORTHWEST][square]); }
 
 Bitboard get_ray_attacks(Bitboard occupied, Direction dir, Square square);
 Bitboard diagonal_attacks(Bitboard occupied, Square square);
 Bitboard anti_diagonal_attacks(Bitboard occupancy, Square square);
-Bitboard single_push(Bitboard pawns, Bitboard empty, int color);
-Bitboard double_push(Bitboard pawns, Bitboard empty, int color);
 
 Bitboard file_attacks(Bitboard occupancy, Square square);
 Bitboard rank_attacks(Bitboard occupancy, Square square);
 
+// Slider attacks computed ray by ray. Used as the reference when filling the magic tables
+Bitboard ray_rook_attacks(Bitboard occupancy, Square square);
+Bitboard ray_bishop_attacks(Bitboard occupancy, Square square);
+
+// Fancy magic bitboard entry of a single square. The attack set of every relevant occupancy
+// is stored at attacks[index(occupancy)]. Built with USE_PEXT, the index is the BMI2 parallel
+// bit extract of the occupancy instead of the magic multiplication
+struct Magic
+{
+    Bitboard* attacks;
+    Bitboard mask;
+    Bitboard magic;
+    int shift;
+
+    unsigned index(Bitboard occupancy) const
+    {
+#ifdef USE_PEXT
+        return unsigned(pext(occupancy, mask));
+#else
+        return unsigned(((occupancy & mask) * magic) >> shift);
+#endif
+    }
+};
+
+extern Bitboard rook_table[0x19000];
+extern Bitboard bishop_table[0x1480];
+
+// Filled while the program loads, so the lookups below are valid from main on
+extern Magic rook_magics[64];
+extern Magic bishop_magics[64];
+
 // Piece attacks
-Bitboard rook_attacks(Bitboard occupancy, Square square);
-Bitboard bishop_attacks(Bitboard occupancy, Square square);
-Bitboard queen_attacks(Bitboard occupancy, Square square);
-Bitboard knight_attacks(Bitboard knights);
-Bitboard king_attacks(Bitboard king);
-Bitboard pawn_attacks(Bitboard square, int color);
+inline Bitboard rook_attacks(Bitboard occupancy, Square square) { return rook_magics[square].attacks[rook_magics[square].index(occupancy)]; }
+inline Bitboard bishop_attacks(Bitboard occupancy, Square square) { return bishop_magics[square].attacks[bishop_magics[square].index(occupancy)]; }
+inline Bitboard queen_attacks(Bitboard occupancy, Square square) { return rook_attacks(occupancy, square) | bishop_attacks(occupancy, square); }
+inline Bitboard knight_attacks(Square square) { return ATTACKS.knight[square]; }
+inline Bitboard king_attacks(Square square) { return ATTACKS.king[square]; }
+inline Bitboard pawn_attacks(Square square, int color) { return ATTACKS.pawn[color][square]; }
 
 // Piece moves
 Bitboard pawn_moves(const Position& position, Square square, int color);
@@ -70,33 +119,57 @@ Bitboard moves(Square square, const Position& position);
 // Generate legal moves of a piece given a square
 Bitboard legal_moves(const Position& position, Square square, std::vector<Move>* legal_moves_list = nullptr);
 
+// Check and pin information for the side to move, computed once per position
+struct CheckInfo
+{
+    Square king_square;
+    // Enemy pieces giving check
+    Bitboard checkers;
+    // Friendly pieces pinned to the king. A pinned piece may only move along ATTACKS.line[king_square][square]
+    Bitboard pinned;
+    // Destinations that capture or block a single checker. Every square when not in check, none in double check
+    Bitboard check_mask;
+};
+
+CheckInfo check_info(const Position& position);
+
+// Fixed-capacity move buffer meant to live on the stack. 256 is above the number of legal moves any position can have
+struct MoveList
+{
+    // Left uninitialized, only the first size entries are valid
+    union { Move moves[256]; };
+    int size = 0;
+
+    MoveList() {}
+
+    void push(const Move& move) { moves[size++] = move; }
+    void clear() { size = 0; }
+    Move& operator[](int index) { return moves[index]; }
+    const Move& operator[](int index) const { return moves[index]; }
+    Move* begin() { return moves; }
+    Move* end() { return moves + size; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + size; }
+};
+
+// Looks up the legal move with the from, to and promotion of move, e.g. a hash move or killer found in another
+// position, and stores it with its piece, capture and flags for this one. False when there is no such move
+bool find_legal_move(const Position& position, const Move& move, Move& legal);
+
+// Whole-position generators for the side to move. Moves are appended to the list
+void generate_legal(const Position& position, MoveList& list);
+// Captures (including en passant) and promotions
+void generate_captures(const Position& position, MoveList& list);
+// Every legal move not produced by generate_captures, castling included
+void generate_quiets(const Position& position, MoveList& list);
+
 bool is_valid_square(const Position& position, Square square);
 bool is_friendly_square(const Position& position, Square square);
 
 bool is_attacked(const Position& position, Square square, int attacking_color);
 Bitboard attacked_by(const Position& position, Square square, int attacking_color);
+// Attackers of a square given an alternate occupancy, e.g. with a piece lifted off the board
+Bitboard attacked_by(const Position& position, Square square, int attacking_color, Bitboard occupancy);
 bool is_king_in_check(const Position& position, int attacking_color);
 
-// Magic Bitnboard implementation (WIP)
-
-//void init_magics(bool is_rook, Bitboard piece_table[], Magic magics[]);
-//struct Magic
-//{
-//	Bitboard* attacks;
-//	Bitboard mask;
-//	Bitboard magic;
-//	int shift;
-
-//	unsigned index(Bitboard occ)
-//	{
-//		return unsigned(((occ & mask) * magic) >> shift);
-//	}
-//};
-
-//Bitboard rook_table[0x19000];
-//Bitboard bishop_table[0x1480];
-
-//Magic rook_magics[64];
-//Magic bishop_magics[64];
-
 #endif // MOVEGEN_H
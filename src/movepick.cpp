@@ -0,0 +1,212 @@
+#include "movepick.h"
+#include "evaluate.h"
+#include "see.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    // History scores are kept within this range, so recent results outweigh old ones
+    const int HISTORY_MAX = 16384;
+
+    // Most valuable victim first, then least valuable attacker. Promotions add the value of the new piece
+    int capture_score(const Move& move)
+    {
+        int score = 0;
+        if (move.captured_type != -1)
+            score += 8 * PIECE_VALUES[move.captured_type] - PIECE_VALUES[move.piece_type] / 8;
+        if (move.promotion != -1)
+            score += PIECE_VALUES[move.promotion];
+        return score;
+    }
+
+    // Captures that lose material are tried after the quiets. Taking a piece worth at least the capturer cannot, so the
+    // exchange is only evaluated for the others
+    bool is_good_capture(const Position& position, const Move& move)
+    {
+        if (move.promotion != -1 && move.promotion != QUEEN)
+            return false;
+        if (move.captured_type != -1 && PIECE_VALUES[move.captured_type] >= PIECE_VALUES[move.piece_type])
+            return true;
+        return see(position, move) >= 0;
+    }
+
+    // Moves the entry towards HISTORY_MAX or -HISTORY_MAX by bonus, more slowly the closer it already is
+    void apply_bonus(int& entry, int bonus)
+    {
+        entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+    }
+}
+
+void MoveHistory::clear()
+{
+    std::memset(butterfly, 0, sizeof(butterfly));
+    for (auto& color : counter_moves)
+        for (auto& type : color)
+            for (Move& move : type)
+                move = Move {};
+}
+
+void MoveHistory::update(const Move& best, const Move* tried, int tried_count, int depth)
+{
+    int bonus = std::min(depth * depth, HISTORY_MAX / 4);
+
+    apply_bonus(butterfly[best.color][best.from][best.to], bonus);
+    for (int i = 0; i < tried_count; ++i)
+    {
+        if (tried[i] != best)
+            apply_bonus(butterfly[tried[i].color][tried[i].from][tried[i].to], -bonus);
+    }
+}
+
+MovePicker::MovePicker(const Position& position, const Move* tt_move, const Move* killers, const Move* counter_move, const MoveHistory& history)
+    : position(position), history(history)
+{
+    if (tt_move)
+        has_tt_move = find_legal_move(position, *tt_move, this->tt_move);
+
+    for (int i = 0; i < 2; ++i)
+        refutations[refutation_count++] = killers[i];
+    if (counter_move)
+        refutations[refutation_count++] = *counter_move;
+}
+
+MovePicker::MovePicker(const Position& position, const Move* tt_move, const MoveHistory& history)
+    : position(position), history(history), captures_only(true)
+{
+    if (tt_move && find_legal_move(position, *tt_move, this->tt_move))
+        has_tt_move = (this->tt_move.captured_type != -1 || this->tt_move.promotion == QUEEN) && is_good_capture(position, this->tt_move);
+}
+
+void MovePicker::pick_best(int end)
+{
+    int best = current;
+    for (int i = current + 1; i < end; ++i)
+        if (scores[i] > scores[best])
+            best = i;
+
+    std::swap(moves[current], moves[best]);
+    std::swap(scores[current], scores[best]);
+}
+
+bool MovePicker::is_emitted_early(const Move& move) const
+{
+    if (has_tt_move && move == tt_move)
+        return true;
+    for (int i = 0; i < refutation_count; ++i)
+        if (move == refutations[i])
+            return true;
+    return false;
+}
+
+bool MovePicker::next(Move& move)
+{
+    switch (stage)
+    {
+    case TT_MOVE:
+        stage = GENERATE_CAPTURES;
+        if (has_tt_move)
+        {
+            move = tt_move;
+            return true;
+        }
+        [[fallthrough]];
+
+    case GENERATE_CAPTURES:
+        generate_captures(position, moves);
+        captures_end = moves.size;
+        for (int i = 0; i < captures_end; ++i)
+            scores[i] = capture_score(moves[i]);
+        stage = GOOD_CAPTURES;
+        [[fallthrough]];
+
+    case GOOD_CAPTURES:
+        while (current < captures_end)
+        {
+            pick_best(captures_end);
+            Move& candidate = moves[current++];
+
+            if (has_tt_move && candidate == tt_move)
+                continue;
+            if (!is_good_capture(position, candidate))
+            {
+                moves[bad_captures_end++] = candidate;
+                continue;
+            }
+
+            move = candidate;
+            return true;
+        }
+        // Bad captures are dropped outright in quiescence search
+        if (captures_only)
+        {
+            stage = DONE;
+            return false;
+        }
+        stage = REFUTATIONS;
+        [[fallthrough]];
+
+    case REFUTATIONS:
+        // Killers and counter moves come from other positions, so only legal quiets not returned already are used
+        while (refutation_index < refutation_count)
+        {
+            Move& candidate = refutations[refutation_index];
+            Move legal;
+            bool duplicate = has_tt_move && candidate == tt_move;
+            for (int i = 0; i < refutation_index && !duplicate; ++i)
+                duplicate = candidate == refutations[i];
+
+            if (!duplicate && find_legal_move(position, candidate, legal) && legal.captured_type == -1 && legal.promotion == -1)
+            {
+                refutation_index++;
+                move = legal;
+                return true;
+            }
+
+            // Rejected refutations must not hide the same move in the quiet stage
+            candidate = Move {};
+            refutation_index++;
+        }
+        stage = GENERATE_QUIETS;
+        [[fallthrough]];
+
+    case GENERATE_QUIETS:
+        generate_quiets(position, moves);
+        for (int i = captures_end; i < moves.size; ++i)
+            scores[i] = history.butterfly[moves[i].color][moves[i].from][moves[i].to];
+        current = captures_end;
+        stage = QUIETS;
+        [[fallthrough]];
+
+    case QUIETS:
+        while (current < moves.size)
+        {
+            pick_best(moves.size);
+            Move& candidate = moves[current++];
+
+            if (is_emitted_early(candidate))
+                continue;
+
+            move = candidate;
+            return true;
+        }
+        current = 0;
+        stage = BAD_CAPTURES;
+        [[fallthrough]];
+
+    case BAD_CAPTURES:
+        if (current < bad_captures_end)
+        {
+            move = moves[current++];
+            return true;
+        }
+        stage = DONE;
+        [[fallthrough]];
+
+    case DONE:
+        return false;
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+#ifndef MOVEPICK_H
+#define MOVEPICK_H
+
+#include "movegen.h"
+
+// Quiet move ordering statistics, gathered by one search thread over a search
+struct MoveHistory
+{
+    // [color][from][to] score of quiet moves, raised when they cause a cutoff and lowered when they are tried before one
+    int butterfly[2][64][64];
+    // [color][piece type][to] of a move: the quiet reply that last refuted it
+    Move counter_moves[2][6][64];
+
+    void clear();
+    // Rewards the quiet move that caused a cutoff at depth and penalizes the quiets searched before it
+    void update(const Move& best, const Move* tried, int tried_count, int depth);
+};
+
+// Returns the legal moves of a position one at a time, best guesses first, generating each group of moves only when
+// the previous ones are used up, so a cutoff on an early move skips generating the rest. The order is:
+// hash move, good captures by MVV-LVA, killers, counter move, quiets by history score, bad captures.
+// Captures are good when static exchange evaluation says they do not lose material
+class MovePicker
+{
+public:
+    // Moves not legal in the position are skipped, so hash moves, killers and counter moves need no checking beforehand.
+    // killers points to two moves, counter_move may be null
+    MovePicker(const Position& position, const Move* tt_move, const Move* killers, const Move* counter_move, const MoveHistory& history);
+    // Quiescence search picker: good captures and queen promotions only, hash move first when it is one of them
+    MovePicker(const Position& position, const Move* tt_move, const MoveHistory& history);
+
+    // Stores the next move and returns true, or returns false once every legal move has been returned
+    bool next(Move& move);
+
+private:
+    enum Stage
+    {
+        TT_MOVE,
+        GENERATE_CAPTURES,
+        GOOD_CAPTURES,
+        REFUTATIONS,
+        GENERATE_QUIETS,
+        QUIETS,
+        BAD_CAPTURES,
+        DONE
+    };
+
+    const Position& position;
+    const MoveHistory& history;
+    Stage stage = TT_MOVE;
+    bool captures_only = false;
+
+    Move tt_move {};
+    bool has_tt_move = false;
+    // Killers then counter move, still to be checked for legality
+    Move refutations[3];
+    int refutation_count = 0;
+    int refutation_index = 0;
+
+    // Captures, then the quiets appended after them. Bad captures are moved to the front of the list as they are
+    // found, so they are kept without a second list
+    MoveList moves;
+    int scores[256];
+    int current = 0;
+    int bad_captures_end = 0;
+    int captures_end = 0;
+
+    // Index of the best scored move in [current, end), swapped to current
+    void pick_best(int end);
+    bool is_emitted_early(const Move& move) const;
+};
+
+#endif // MOVEPICK_H
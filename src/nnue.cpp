@@ -0,0 +1,263 @@
+#include "nnue.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <utility>
+
+// The kernels follow the instruction set the build targets. SSE2 is part of x86-64, AVX2 needs USE_AVX2
+#if defined(__AVX2__)
+#define NNUE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define NNUE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const char MAGIC[8] = { 'B', 'B', 'C', 'N', 'N', 'U', 'E', '1' };
+    const size_t HEADER_SIZE = 64;
+
+    // Accumulator values are clipped to [0, CLIP] before the output layer, whose weights are scaled by OUTPUT_SCALE
+    const int CLIP = 255;
+    const int OUTPUT_SCALE = 64;
+    // Centipawns per unit of network output
+    const int EVAL_SCALE = 400;
+
+    // At most the 32 pieces of a position are active per side
+    const int MAX_ACTIVE = 32;
+
+    const size_t FILE_SIZE = HEADER_SIZE + sizeof(int16_t) * (size_t(NNUE_FEATURES) * NNUE_HIDDEN + 3 * NNUE_HIDDEN) + sizeof(int32_t);
+
+    struct Network
+    {
+        const int16_t* feature_weights = nullptr;
+        const int16_t* feature_biases = nullptr;
+        const int16_t* output_weights = nullptr;
+        int32_t output_bias = 0;
+    };
+
+    Network network;
+    // The file the network's weights point into
+    MappedFile network_file;
+
+    // Feature of a piece as seen by perspective, whose king is on king
+    int feature_index(int perspective, int king, int color, int type, int square)
+    {
+        if (perspective == BLACK)
+        {
+            king ^= 56;
+            square ^= 56;
+        }
+        int piece = (color == perspective ? 0 : 6) + type;
+        return (king * 12 + piece) * 64 + square;
+    }
+
+    const int16_t* weight_row(int feature)
+    {
+        return network.feature_weights + size_t(feature) * NNUE_HIDDEN;
+    }
+
+    // out = in plus the weight rows of the added features minus those of the removed ones, in one pass over the
+    // accumulator so each chunk stays in a register while every row is applied to it
+    void apply_features(const int16_t* in, int16_t* out, const int* added, int add_count, const int* removed, int remove_count)
+    {
+#if defined(NNUE_AVX2)
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m256i sum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            for (int k = 0; k < add_count; ++k)
+                sum = _mm256_add_epi16(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weight_row(added[k]) + i)));
+            for (int k = 0; k < remove_count; ++k)
+                sum = _mm256_sub_epi16(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weight_row(removed[k]) + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), sum);
+        }
+#elif defined(NNUE_SSE2)
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            __m128i sum = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            for (int k = 0; k < add_count; ++k)
+                sum = _mm_add_epi16(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(weight_row(added[k]) + i)));
+            for (int k = 0; k < remove_count; ++k)
+                sum = _mm_sub_epi16(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(weight_row(removed[k]) + i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), sum);
+        }
+#else
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            int16_t sum = in[i];
+            for (int k = 0; k < add_count; ++k)
+                sum = int16_t(sum + weight_row(added[k])[i]);
+            for (int k = 0; k < remove_count; ++k)
+                sum = int16_t(sum - weight_row(removed[k])[i]);
+            out[i] = sum;
+        }
+#endif
+    }
+
+    // Dot product of the clipped accumulator with NNUE_HIDDEN output weights
+    int32_t output_dot(const int16_t* values, const int16_t* weights)
+    {
+#if defined(NNUE_AVX2)
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i clip = _mm256_set1_epi16(CLIP);
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            v = _mm256_min_epi16(_mm256_max_epi16(v, zero), clip);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i))));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        return _mm_cvtsi128_si32(half);
+#elif defined(NNUE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i clip = _mm_set1_epi16(CLIP);
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+            v = _mm_min_epi16(_mm_max_epi16(v, zero), clip);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i))));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return _mm_cvtsi128_si32(sum);
+#else
+        int32_t sum = 0;
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            int v = values[i] < 0 ? 0 : values[i] > CLIP ? CLIP : values[i];
+            sum += v * weights[i];
+        }
+        return sum;
+#endif
+    }
+
+    void refresh_perspective(const Position& position, int perspective, int16_t* values)
+    {
+        int king = bit_scan_forward(position.pieces[perspective][KING]);
+        int features[MAX_ACTIVE];
+        int count = 0;
+
+        for (int color = WHITE; color <= BLACK; ++color)
+        {
+            for (int type = PAWN; type <= KING; ++type)
+            {
+                Bitboard pieces = position.pieces[color][type];
+                while (pieces && count < MAX_ACTIVE)
+                {
+                    features[count++] = feature_index(perspective, king, color, type, bit_scan_forward(pieces));
+                    pieces &= pieces - 1;
+                }
+            }
+        }
+
+        apply_features(network.feature_biases, values, features, count, nullptr, 0);
+    }
+}
+
+bool nnue_load(const std::string& path, std::string& error)
+{
+    MappedFile file;
+    if (!file.open(path, error))
+        return false;
+
+    const unsigned char* bytes = file.data();
+    uint32_t features = 0, hidden = 0;
+    if (file.size() >= HEADER_SIZE)
+    {
+        std::memcpy(&features, bytes + 8, sizeof(features));
+        std::memcpy(&hidden, bytes + 12, sizeof(hidden));
+    }
+
+    if (file.size() != FILE_SIZE || std::memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0 || features != NNUE_FEATURES || hidden != NNUE_HIDDEN)
+    {
+        error = path + " is not a " + std::to_string(NNUE_FEATURES) + "x" + std::to_string(NNUE_HIDDEN) + " network";
+        return false;
+    }
+
+    nnue_unload();
+
+    network_file = std::move(file);
+    network.feature_weights = reinterpret_cast<const int16_t*>(bytes + HEADER_SIZE);
+    network.feature_biases = network.feature_weights + size_t(NNUE_FEATURES) * NNUE_HIDDEN;
+    network.output_weights = network.feature_biases + NNUE_HIDDEN;
+    std::memcpy(&network.output_bias, network.output_weights + 2 * NNUE_HIDDEN, sizeof(network.output_bias));
+    return true;
+}
+
+void nnue_unload()
+{
+    network_file.close();
+    network = Network {};
+}
+
+bool nnue_loaded()
+{
+    return network_file.is_open();
+}
+
+const char* nnue_simd()
+{
+#if defined(NNUE_AVX2)
+    return "avx2";
+#elif defined(NNUE_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void nnue_refresh(const Position& position, NnueAccumulator& accumulator)
+{
+    refresh_perspective(position, WHITE, accumulator.values[WHITE]);
+    refresh_perspective(position, BLACK, accumulator.values[BLACK]);
+}
+
+void nnue_update(const NnueAccumulator& parent, const Position& position, const Move& move, NnueAccumulator& child)
+{
+    int color = move.color;
+    int enemy = color ^ 1;
+
+    for (int perspective = WHITE; perspective <= BLACK; ++perspective)
+    {
+        // Every feature of the side whose king moved changes
+        if (move.piece_type == KING && perspective == color)
+        {
+            refresh_perspective(position, perspective, child.values[perspective]);
+            continue;
+        }
+
+        int king = bit_scan_forward(position.pieces[perspective][KING]);
+        int added[2], removed[2];
+        int add_count = 0, remove_count = 0;
+
+        removed[remove_count++] = feature_index(perspective, king, color, move.piece_type, move.from);
+        added[add_count++] = feature_index(perspective, king, color, move.promotion != -1 ? move.promotion : move.piece_type, move.to);
+
+        if (move.is_castling)
+        {
+            Square rook_from = move.to > move.from ? ROOKS_KINGSIDE[color] : ROOKS_QUEENSIDE[color];
+            int rook_to = move.to > move.from ? rook_from - 2 : rook_from + 3;
+            removed[remove_count++] = feature_index(perspective, king, color, ROOK, rook_from);
+            added[add_count++] = feature_index(perspective, king, color, ROOK, rook_to);
+        }
+        else if (move.is_en_passant)
+            removed[remove_count++] = feature_index(perspective, king, enemy, PAWN, color == WHITE ? move.to - 8 : move.to + 8);
+        else if (move.captured_type != -1)
+            removed[remove_count++] = feature_index(perspective, king, enemy, move.captured_type, move.to);
+
+        apply_features(parent.values[perspective], child.values[perspective], added, add_count, removed, remove_count);
+    }
+}
+
+int nnue_evaluate(const Position& position, const NnueAccumulator& accumulator)
+{
+    int us = position.color_to_move;
+    int32_t output = output_dot(accumulator.values[us], network.output_weights)
+                   + output_dot(accumulator.values[us ^ 1], network.output_weights + NNUE_HIDDEN)
+                   + network.output_bias;
+    return int(int64_t(output) * EVAL_SCALE / (CLIP * OUTPUT_SCALE));
+}
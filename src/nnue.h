@@ -0,0 +1,52 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "position.h"
+#include <cstdint>
+#include <string>
+
+/*
+    Efficiently updatable neural network evaluation.
+
+    Input features are (king square, piece, square) triples seen from each side's point of view: 64 king squares times
+    12 pieces (own first) times 64 squares, with black's board flipped vertically. The feature transformer sums the
+    weight rows of the active features into NNUE_HIDDEN int16 values per side. A move changes only a few features, so a
+    child position's accumulator is its parent's plus and minus a few rows, except for the side whose king moved, which
+    is rebuilt. The output layer takes both accumulators clipped to [0, 255], side to move first, dotted with the
+    output weights.
+
+    Network file, little-endian:
+        char[8]  "BBCNNUE1"
+        uint32   NNUE_FEATURES
+        uint32   NNUE_HIDDEN
+        zero padding up to 64 bytes
+        int16    feature weights [NNUE_FEATURES][NNUE_HIDDEN]
+        int16    feature biases [NNUE_HIDDEN]
+        int16    output weights [2 * NNUE_HIDDEN]
+        int32    output bias
+    The file is memory-mapped and used in place, so its pages are shared by every search thread and process
+*/
+constexpr int NNUE_FEATURES = 64 * 12 * 64;
+constexpr int NNUE_HIDDEN = 256;
+
+struct alignas(64) NnueAccumulator
+{
+    // [perspective color][neuron]
+    int16_t values[2][NNUE_HIDDEN];
+};
+
+// Maps the network at path, replacing the one loaded before. Not safe while a search is running
+bool nnue_load(const std::string& path, std::string& error);
+void nnue_unload();
+bool nnue_loaded();
+// Instruction set of the kernels compiled in: "avx2", "sse2" or "scalar"
+const char* nnue_simd();
+
+// Builds the accumulator of a position from scratch
+void nnue_refresh(const Position& position, NnueAccumulator& accumulator);
+// Accumulator of position from that of the position before move was played in it
+void nnue_update(const NnueAccumulator& parent, const Position& position, const Move& move, NnueAccumulator& child);
+// Centipawns from the side to move's point of view
+int nnue_evaluate(const Position& position, const NnueAccumulator& accumulator);
+
+#endif // NNUE_H
@@ -0,0 +1,208 @@
+#include "perft.h"
+#include "movegen.h"
+#include "moveexec.h"
+#include "threadpool.h"
+
+PerftTable::PerftTable(size_t megabytes)
+{
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024)
+        count *= 2;
+
+    entries = std::vector<Entry>(count);
+    index_mask = count - 1;
+}
+
+// Depth is kept in the low byte of the data, the node count in the remaining 56 bits
+bool PerftTable::probe(Bitboard hash, int depth, unsigned long long& nodes) const
+{
+    const Entry& entry = entries[hash & index_mask];
+    Bitboard data = entry.data.load(std::memory_order_relaxed);
+    Bitboard key = entry.key.load(std::memory_order_relaxed);
+
+    if ((key ^ data) != hash || int(data & 0xFF) != depth)
+        return false;
+
+    nodes = data >> 8;
+    return true;
+}
+
+void PerftTable::store(Bitboard hash, int depth, unsigned long long nodes)
+{
+    Entry& entry = entries[hash & index_mask];
+    Bitboard data = (nodes << 8) | Bitboard(depth);
+
+    entry.key.store(hash ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+unsigned long long perft(const Position& position, int depth)
+{
+    if (depth == 0) return 1ULL;
+
+    MoveList list;
+    generate_legal(position, list);
+
+    if (depth == 1) return list.size;
+
+    unsigned long long nodes = 0ULL;
+
+    for (const Move& move : list)
+    {
+        Position new_position = position;
+        do_move(move, new_position);
+        nodes += perft(new_position, depth - 1);
+    }
+
+    return nodes;
+}
+
+unsigned long long perft_unmake(Position& position, int depth)
+{
+    if (depth == 0) return 1ULL;
+
+    MoveList list;
+    generate_legal(position, list);
+
+    if (depth == 1) return list.size;
+
+    unsigned long long nodes = 0ULL;
+    UndoInfo undo;
+
+    for (const Move& move : list)
+    {
+        do_move(move, position, undo);
+        nodes += perft_unmake(position, depth - 1);
+        unmake_move(move, undo, position);
+    }
+
+    return nodes;
+}
+
+unsigned long long perft(const Position& position, int depth, PerftTable& table, PerftTableStats& stats)
+{
+    // The last ply is bulk counted, which is cheaper than a probe
+    if (depth <= 1) return perft(position, depth);
+
+    Bitboard hash = position.hash;
+    unsigned long long nodes = 0ULL;
+
+    stats.probes++;
+    if (table.probe(hash, depth, nodes))
+    {
+        stats.hits++;
+        return nodes;
+    }
+
+    MoveList list;
+    generate_legal(position, list);
+
+    for (const Move& move : list)
+    {
+        Position new_position = position;
+        do_move(move, new_position);
+        nodes += perft(new_position, depth - 1, table, stats);
+    }
+
+    table.store(hash, depth, nodes);
+    return nodes;
+}
+
+std::vector<DivideEntry> divide(const Position& position, int depth, PerftTable* table, PerftTableStats* stats)
+{
+    std::vector<DivideEntry> entries;
+    PerftTableStats local_stats;
+
+    MoveList list;
+    generate_legal(position, list);
+
+    for (const Move& move : list)
+    {
+        Position new_position = position;
+        do_move(move, new_position);
+        entries.push_back({ move, table ? perft(new_position, depth - 1, *table, local_stats) : perft(new_position, depth - 1) });
+    }
+
+    if (stats)
+    {
+        stats->probes += local_stats.probes;
+        stats->hits += local_stats.hits;
+    }
+
+    return entries;
+}
+
+ParallelPerftResult parallel_perft(const Position& position, int depth, int thread_count, PerftTable* table)
+{
+    ParallelPerftResult result;
+
+    MoveList root_moves;
+    generate_legal(position, root_moves);
+
+    WorkStealingPool pool(thread_count);
+
+    // Every worker writes only its own row, so no synchronization is needed while counting
+    std::vector<std::vector<unsigned long long>> counts(pool.size(), std::vector<unsigned long long>(root_moves.size, 0ULL));
+    std::vector<PerftTableStats> stats(pool.size());
+
+    auto count_subtree = [&counts, &stats, table](const Position& child, int child_depth, int root_index, int worker)
+    {
+        if (!table)
+        {
+            counts[worker][root_index] += perft(child, child_depth);
+            return;
+        }
+
+        // Counted locally so workers do not share cache lines in the hot loop
+        PerftTableStats task_stats;
+        counts[worker][root_index] += perft(child, child_depth, *table, task_stats);
+        stats[worker].probes += task_stats.probes;
+        stats[worker].hits += task_stats.hits;
+    };
+
+    for (int i = 0; i < root_moves.size; ++i)
+    {
+        Position root_child = position;
+        do_move(root_moves[i], root_child);
+
+        if (depth <= 2)
+        {
+            pool.submit([count_subtree, root_child, depth, i](int worker) { count_subtree(root_child, depth - 1, i, worker); });
+            continue;
+        }
+
+        MoveList replies;
+        generate_legal(root_child, replies);
+
+        for (const Move& reply : replies)
+        {
+            Position child = root_child;
+            do_move(reply, child);
+            pool.submit([count_subtree, child, depth, i](int worker) { count_subtree(child, depth - 2, i, worker); });
+        }
+    }
+
+    pool.wait();
+
+    result.thread_nodes.assign(pool.size(), 0ULL);
+
+    for (int i = 0; i < root_moves.size; ++i)
+    {
+        unsigned long long nodes = 0ULL;
+        for (int worker = 0; worker < pool.size(); ++worker)
+        {
+            nodes += counts[worker][i];
+            result.thread_nodes[worker] += counts[worker][i];
+        }
+        result.divide.push_back({ root_moves[i], nodes });
+        result.nodes += nodes;
+    }
+
+    for (const PerftTableStats& worker_stats : stats)
+    {
+        result.table_stats.probes += worker_stats.probes;
+        result.table_stats.hits += worker_stats.hits;
+    }
+
+    return result;
+}
@@ -0,0 +1,70 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "position.h"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Node count of a single root move
+struct DivideEntry
+{
+    Move move;
+    unsigned long long nodes;
+};
+
+struct PerftTableStats
+{
+    unsigned long long probes = 0ULL;
+    unsigned long long hits = 0ULL;
+};
+
+// Fixed-size cache of subtree node counts keyed by position hash and depth. Entries are stored as
+// (hash ^ data, data) pairs of relaxed atomics, so threads can share the table without locks: an entry
+// torn by a concurrent write no longer XORs back to the hash and simply reads as a miss
+class PerftTable
+{
+public:
+    explicit PerftTable(size_t megabytes);
+
+    bool probe(Bitboard hash, int depth, unsigned long long& nodes) const;
+    void store(Bitboard hash, int depth, unsigned long long nodes);
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::atomic<Bitboard> key;
+        std::atomic<Bitboard> data;
+    };
+
+    std::vector<Entry> entries;
+    Bitboard index_mask;
+};
+
+// Counts the leaf nodes of the legal move tree to the given depth. The last ply is bulk counted from the size of the move list
+unsigned long long perft(const Position& position, int depth);
+
+// Same count using do_move/unmake_move on a single position instead of copying it at every node
+unsigned long long perft_unmake(Position& position, int depth);
+
+// Perft that looks up and caches subtree counts in the table, so transposed subtrees are only walked once
+unsigned long long perft(const Position& position, int depth, PerftTable& table, PerftTableStats& stats);
+
+// Perft split by root move, in generation order. Hashed when a table is given
+std::vector<DivideEntry> divide(const Position& position, int depth, PerftTable* table = nullptr, PerftTableStats* stats = nullptr);
+
+struct ParallelPerftResult
+{
+    std::vector<DivideEntry> divide;
+    // Nodes counted by each worker thread
+    std::vector<unsigned long long> thread_nodes;
+    unsigned long long nodes = 0ULL;
+    PerftTableStats table_stats;
+};
+
+// Perft spread over a work-stealing thread pool. The tree is split two plies below the root into
+// independent subtrees, so idle threads keep stealing work until the slowest subtrees are done
+ParallelPerftResult parallel_perft(const Position& position, int depth, int thread_count, PerftTable* table = nullptr);
+
+#endif // PERFT_H
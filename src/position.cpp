@@ -1,5 +1,10 @@
-#include <sstream>
 #include "position.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 
 int max_rank = 8;
 int max_file = 8;
@@ -29,23 +34,29 @@ Square QSIDE_PASS_SQUARES[2][2] = { { d1, c1 }, { d8, c8 } };
 Square KSIDE_KING_DEST[2] = { g1, g8 };
 Square QSIDE_KING_DEST[2] = { c1, c8 };
 
-const Position starting_position
+const Position starting_position = []
 {
-    // [color][[piece type] bitboards
+    Position position
     {
-        { 0x000000000000FF00ULL, 0x0000000000000081ULL, 0x0000000000000042ULL, 0x0000000000000024ULL, 0x0000000000000008ULL, 0x0000000000000010ULL },
-        { 0x00FF000000000000ULL, 0x8100000000000000ULL, 0x4200000000000000ULL, 0x2400000000000000ULL, 0x0800000000000000ULL, 0x1000000000000000ULL }
-    },
-    // occupancy bitboards for both colors
-    {
-        0x000000000000FFFFULL,
-        0xFFFF000000000000ULL
-    },
-    // total occupancy bitboard
-    0xFFFF00000000FFFFULL,
-    // empty square bitboard
-    0x0000FFFFFFFF0000ULL
-};
+        // [color][[piece type] bitboards
+        {
+            { 0x000000000000FF00ULL, 0x0000000000000081ULL, 0x0000000000000042ULL, 0x0000000000000024ULL, 0x0000000000000008ULL, 0x0000000000000010ULL },
+            { 0x00FF000000000000ULL, 0x8100000000000000ULL, 0x4200000000000000ULL, 0x2400000000000000ULL, 0x0800000000000000ULL, 0x1000000000000000ULL }
+        },
+        // occupancy bitboards for both colors
+        {
+            0x000000000000FFFFULL,
+            0xFFFF000000000000ULL
+        },
+        // total occupancy bitboard
+        0xFFFF00000000FFFFULL,
+        // empty square bitboard
+        0x0000FFFFFFFF0000ULL
+    };
+    position.hash = position_hash(position);
+    compute_psq(position);
+    return position;
+}();
 
 void update_occupancies(Position& position) {
     position.occupancy[WHITE] = position.pieces[WHITE][PAWN] | position.pieces[WHITE][KNIGHT] | position.pieces[WHITE][BISHOP] | position.pieces[WHITE][ROOK] | position.pieces[WHITE][QUEEN] | position.pieces[WHITE][KING];
@@ -56,6 +67,8 @@ void update_occupancies(Position& position) {
 
 void update_castle_rights(Position& position, const Move &move)
 {
+    position.hash ^= castling_hash(position);
+
     switch (move.piece_type)
     {
     case KING:
@@ -78,92 +91,327 @@ void update_castle_rights(Position& position, const Move &move)
         else if (move.to == ROOKS_QUEENSIDE[move.color ^ 1])
             position.castling_rights[move.color ^ 1] = CastlingRights(position.castling_rights[move.color ^ 1] & ~QS);
     }
+
+    position.hash ^= castling_hash(position);
 }
 
-Position fen_to_pos(std::string fen)
+namespace
 {
-    Position position = {};
+    // FEN letters by [color][piece type]
+    const char FEN_PIECES[2][7] = { "PRNBQK", "prnbqk" };
 
-    size_t meta_index;
+    // 1 + 8 * color + piece type by FEN letter, 0 for other characters
+    struct PieceLetters
+    {
+        unsigned char value[128];
+    };
+
+    constexpr PieceLetters PIECE_LETTERS = []
+    {
+        PieceLetters letters {};
+        for (int color = WHITE; color <= BLACK; ++color)
+            for (int type = PAWN; type <= KING; ++type)
+                letters.value[int(FEN_PIECES[color][type])] = (unsigned char)(1 + 8 * color + type);
+        return letters;
+    }();
+
+    bool is_fen_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
 
-    std::stringstream ss(fen.substr(0, meta_index = fen.find_first_of(' ')));
-    std::stringstream ss_meta(fen.substr(meta_index));
-    std::string token;
+    // Field starting at or after index, which is left just past it. Empty once the FEN is used up
+    std::string_view next_field(std::string_view fen, size_t& index)
+    {
+        while (index < fen.size() && is_fen_space(fen[index]))
+            index++;
+        size_t start = index;
+        while (index < fen.size() && !is_fen_space(fen[index]))
+            index++;
+        return fen.substr(start, index - start);
+    }
 
-    int square = 63;
+    bool parse_number(std::string_view field, int& value)
+    {
+        const char* end = field.data() + field.size();
+        std::from_chars_result result = std::from_chars(field.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end && value >= 0;
+    }
 
-    while (std::getline(ss, token, '/'))
+    bool parse_board(std::string_view board, Position& position, std::string& error)
     {
-        for (int k = static_cast<int>(token.length() - 1); k >= 0; k--)
+        int rank = 7, file = 0;
+        for (char c : board)
         {
-            char c = token[k];
-            if (isdigit(c))
+            if (c == '/')
             {
-                square -= (c - '0');
+                if (file != 8 || rank == 0)
+                {
+                    error = "FEN board: rank " + std::to_string(rank + 1) + (file != 8 ? " does not have 8 squares" : " is followed by a ninth");
+                    return false;
+                }
+                rank--;
+                file = 0;
                 continue;
             }
 
-            switch (c)
+            int squares = 1;
+            if (c >= '1' && c <= '8')
+                squares = c - '0';
+            else
+            {
+                int piece = (unsigned char)c < 128 ? PIECE_LETTERS.value[(unsigned char)c] - 1 : -1;
+                if (piece < 0)
+                {
+                    error = std::string("FEN board: unknown piece '") + c + "'";
+                    return false;
+                }
+                if (file < 8)
+                    set_bit(position.pieces[piece / 8][piece % 8], rank * 8 + file);
+            }
+
+            file += squares;
+            if (file > 8)
             {
-            case 'P':
-                set_bit(position.pieces[WHITE][PAWN], square);
-                break;
-            case 'R':
-                set_bit(position.pieces[WHITE][ROOK], square);
-                break;
-            case 'N':
-                set_bit(position.pieces[WHITE][KNIGHT], square);
-                break;
-            case 'B':
-                set_bit(position.pieces[WHITE][BISHOP], square);
-                break;
-            case 'Q':
-                set_bit(position.pieces[WHITE][QUEEN], square);
-                break;
-            case 'K':
-                set_bit(position.pieces[WHITE][KING], square);
-                break;
-            case 'p':
-                set_bit(position.pieces[BLACK][PAWN], square);
-                break;
-            case 'r':
-                set_bit(position.pieces[BLACK][ROOK], square);
-                break;
-            case 'n':
-                set_bit(position.pieces[BLACK][KNIGHT], square);
-                break;
-            case 'b':
-                set_bit(position.pieces[BLACK][BISHOP], square);
-                break;
-            case 'q':
-                set_bit(position.pieces[BLACK][QUEEN], square);
-                break;
-            case 'k':
-                set_bit(position.pieces[BLACK][KING], square);
-                break;
-            default:
-                break;
+                error = "FEN board: rank " + std::to_string(rank + 1) + " has more than 8 squares";
+                return false;
             }
-            square--;
         }
+
+        if (rank != 0 || file != 8)
+        {
+            error = "FEN board: expected 8 ranks of 8 squares";
+            return false;
+        }
+        return true;
     }
-    update_occupancies(position);
 
-    std::getline(ss_meta, token, ' ');
+    // Every field after the board may be left out, keeping its default
+    bool parse_fields(std::string_view fen, Position& position, std::string& error)
+    {
+        size_t index = 0;
+        if (!parse_board(next_field(fen, index), position, error))
+            return false;
+        update_occupancies(position);
+
+        for (int color = WHITE; color <= BLACK; ++color)
+        {
+            if (pop_count(position.pieces[color][KING]) != 1)
+            {
+                error = std::string("FEN board: ") + (color == WHITE ? "white" : "black") + " needs exactly one king";
+                return false;
+            }
+        }
+
+        if ((position.pieces[WHITE][PAWN] | position.pieces[BLACK][PAWN]) & (FIRST_RANK | EIGHT_RANK))
+        {
+            error = "FEN board: pawn on the first or last rank";
+            return false;
+        }
+
+        std::string_view side = next_field(fen, index);
+        if (side.empty())
+            return true;
+        if (side != "w" && side != "b")
+        {
+            error = "FEN side to move: expected w or b, got " + std::string(side);
+            return false;
+        }
+        position.color_to_move = side == "b" ? BLACK : WHITE;
+
+        std::string_view castling = next_field(fen, index);
+        if (castling.empty())
+            return true;
+        position.castling_rights[WHITE] = position.castling_rights[BLACK] = NONE;
+        if (castling != "-")
+        {
+            for (char c : castling)
+            {
+                const char* right = std::strchr("KQkq", c);
+                if (!c || !right)
+                {
+                    error = "FEN castling rights: expected - or some of KQkq, got " + std::string(castling);
+                    return false;
+                }
+                int color = right - "KQkq" >= 2 ? BLACK : WHITE;
+                position.castling_rights[color] = CastlingRights(position.castling_rights[color] | (c == 'K' || c == 'k' ? KS : QS));
+            }
+        }
+
+        std::string_view en_passant = next_field(fen, index);
+        if (en_passant.empty())
+            return true;
+        if (en_passant != "-")
+        {
+            char rank = position.color_to_move == WHITE ? '6' : '3';
+            if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h' || en_passant[1] != rank)
+            {
+                error = "FEN en passant square: expected - or a square on rank " + std::string(1, rank) + ", got " + std::string(en_passant);
+                return false;
+            }
+            position.en_passant = (en_passant[0] - 'a') + 8 * (rank - '1');
+        }
 
-    position.color_to_move = Color(token[0] == 'b');
+        std::string_view halfmove_clock = next_field(fen, index);
+        if (halfmove_clock.empty())
+            return true;
+        if (!parse_number(halfmove_clock, position.halfmove_clock))
+        {
+            error = "FEN halfmove clock: expected a number, got " + std::string(halfmove_clock);
+            return false;
+        }
 
+        std::string_view fullmove_number = next_field(fen, index);
+        if (fullmove_number.empty())
+            return true;
+        // Moves are numbered from 1
+        if (!parse_number(fullmove_number, position.fullmove_number) || position.fullmove_number < 1)
+        {
+            error = "FEN move number: expected a number from 1, got " + std::string(fullmove_number);
+            return false;
+        }
+
+        std::string_view rest = next_field(fen, index);
+        if (!rest.empty())
+        {
+            error = "FEN: unexpected " + std::string(rest) + " after the move number";
+            return false;
+        }
+        return true;
+    }
+}
+
+bool parse_fen(std::string_view fen, Position& position, std::string& error)
+{
+    position = Position {};
+    bool parsed = parse_fields(fen, position, error);
+
+    // The side to move could take the king. Checked once the side to move is known, which may have been left out
+    int them = position.color_to_move ^ 1;
+    if (parsed && is_attacked(position, Square(bit_scan_forward(position.pieces[them][KING])), position.color_to_move))
+    {
+        error = std::string("FEN: ") + (them == WHITE ? "white" : "black") + " is in check with " +
+                (them == WHITE ? "black" : "white") + " to move";
+        parsed = false;
+    }
+
+    // Rights whose king or rook has left its square, and en passant squares no pawn can take on, are dropped like
+    // the move functions drop them, so that transpositions hash the same
+    for (int color = WHITE; color <= BLACK; ++color)
+    {
+        Bitboard king = position.pieces[color][KING] & (1ULL << (color == WHITE ? e1 : e8));
+        Bitboard rooks = position.pieces[color][ROOK];
+        if (!king || !(rooks & (1ULL << ROOKS_KINGSIDE[color])))
+            position.castling_rights[color] = CastlingRights(position.castling_rights[color] & ~KS);
+        if (!king || !(rooks & (1ULL << ROOKS_QUEENSIDE[color])))
+            position.castling_rights[color] = CastlingRights(position.castling_rights[color] & ~QS);
+    }
+
+    if (position.en_passant != -1 &&
+        !(pawn_attacks(Square(position.en_passant), position.color_to_move ^ 1) & position.pieces[position.color_to_move][PAWN]))
+        position.en_passant = -1;
+
+    update_occupancies(position);
+    position.hash = position_hash(position);
+    compute_psq(position);
+    return parsed;
+}
+
+Position fen_to_pos(std::string_view fen)
+{
+    Position position;
+    std::string error;
+    parse_fen(fen, position, error);
     return position;
 }
 
-std::string pos_stringid(Position position)
+size_t pos_to_fen(const Position& position, char* buffer, size_t size)
 {
-    std::string stringid = "";
-    for (int type = PAWN; type <= KING; type++)
+    char board[64] = {};
+    for (int color = WHITE; color <= BLACK; ++color)
     {
-        stringid += std::to_string(position.pieces[WHITE][type] | position.pieces[BLACK][type]);
+        for (int type = PAWN; type <= KING; ++type)
+        {
+            Bitboard pieces = position.pieces[color][type];
+            while (pieces)
+            {
+                board[bit_scan_forward(pieces)] = FEN_PIECES[color][type];
+                pieces &= pieces - 1;
+            }
+        }
     }
-    stringid += std::to_string(position.color_to_move);
 
-    return stringid;
+    char fen[FEN_BUFFER_SIZE];
+    char* out = fen;
+
+    for (int rank = 7; rank >= 0; --rank)
+    {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file)
+        {
+            char piece = board[rank * 8 + file];
+            if (!piece)
+            {
+                empty++;
+                continue;
+            }
+            if (empty)
+                *out++ = char('0' + empty);
+            empty = 0;
+            *out++ = piece;
+        }
+        if (empty)
+            *out++ = char('0' + empty);
+        if (rank)
+            *out++ = '/';
+    }
+
+    *out++ = ' ';
+    *out++ = position.color_to_move == WHITE ? 'w' : 'b';
+    *out++ = ' ';
+
+    char* castling = out;
+    if (position.castling_rights[WHITE] & KS) *out++ = 'K';
+    if (position.castling_rights[WHITE] & QS) *out++ = 'Q';
+    if (position.castling_rights[BLACK] & KS) *out++ = 'k';
+    if (position.castling_rights[BLACK] & QS) *out++ = 'q';
+    if (out == castling)
+        *out++ = '-';
+    *out++ = ' ';
+
+    if (position.en_passant == -1)
+        *out++ = '-';
+    else
+    {
+        *out++ = char('a' + position.en_passant % 8);
+        *out++ = char('1' + position.en_passant / 8);
+    }
+
+    // An int takes at most 11 characters
+    *out++ = ' ';
+    out = std::to_chars(out, out + 11, position.halfmove_clock).ptr;
+    *out++ = ' ';
+    out = std::to_chars(out, out + 11, position.fullmove_number).ptr;
+
+    size_t length = size_t(out - fen);
+    if (size)
+    {
+        size_t copied = std::min(length, size - 1);
+        std::memcpy(buffer, fen, copied);
+        buffer[copied] = '\0';
+    }
+    return length;
+}
+
+std::string square_to_string(int square)
+{
+    return { char('a' + square % 8), char('1' + square / 8) };
+}
+
+std::string move_to_string(const Move& move)
+{
+    std::string str = square_to_string(move.from) + square_to_string(move.to);
+    if (move.promotion != -1)
+        str += WHITE_PIECE_CHAR[move.promotion];
+    return str;
 }
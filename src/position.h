@@ -1,7 +1,9 @@
 #ifndef POSITION_H
 #define POSITION_H
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include "bitboard.h"
 
 enum PieceType
@@ -63,6 +65,15 @@ struct Position
     Color color_to_move = WHITE;
     GameState state = NORMAL;
     CastlingRights castling_rights[2] { BOTH, BOTH };
+    // Square skipped by a pawn double push on the previous move, only set when an enemy pawn can capture on it
+    int en_passant = -1; // -1 means no en passant square
+    // Plies since the last capture or pawn move
+    int halfmove_clock = 0;
+    int fullmove_number = 1;
+    // Zobrist hash of the pieces, side to move, castling rights and en passant square. Kept up to date by the move functions
+    Bitboard hash = 0ULL;
+    // Material plus piece-square score from white's point of view, [0 = midgame, 1 = endgame]. Kept up to date by the move functions
+    int psq[2] = { 0, 0 };
 };
 
 struct Move
@@ -82,6 +93,10 @@ struct Move
     bool is_en_passant = false;
 };
 
+// Moves of the same position are identified by their squares and promotion
+inline bool operator==(const Move& a, const Move& b) { return a.from == b.from && a.to == b.to && a.promotion == b.promotion; }
+inline bool operator!=(const Move& a, const Move& b) { return !(a == b); }
+
 // Useful constants
 extern int max_rank;
 extern int max_file;
@@ -119,7 +134,17 @@ extern const Position starting_position;
 // Update occupancy bitboards when position changes
 void update_occupancies(Position& position);
 void update_castle_rights(Position& position, const Move& move);
-Position fen_to_pos(std::string fen);
-std::string pos_stringid(Position position);
+// Reads every field of a FEN in one pass, without allocating unless there is an error to report. Fields after the board may be
+// left out and keep their defaults. False, with error set, for a malformed FEN; position then holds what was read before the error
+bool parse_fen(std::string_view fen, Position& position, std::string& error);
+// parse_fen for trusted input, ignoring errors
+Position fen_to_pos(std::string_view fen);
+// Longest FEN pos_to_fen can write, its terminating NUL included
+constexpr size_t FEN_BUFFER_SIZE = 128;
+// Writes the FEN of position to buffer, truncated to size - 1 characters and NUL terminated, and returns its full length
+size_t pos_to_fen(const Position& position, char* buffer, size_t size);
+// Coordinate notation, e.g. "e2e4" or "e7e8q"
+std::string square_to_string(int square);
+std::string move_to_string(const Move& move);
 
 #endif // POSITION_H
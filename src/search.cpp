@@ -0,0 +1,569 @@
+#include "search.h"
+#include "evaluate.h"
+#include "moveexec.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "nnue.h"
+#include "tablebase.h"
+#include "threadpool.h"
+#include "tt.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Window half-width of the first aspiration search, doubled on every fail
+    const int ASPIRATION_DELTA = 25;
+    // Limits are checked every this many nodes
+    const unsigned long long CHECK_INTERVAL = 1024;
+
+    // Mate scores are stored relative to the node rather than the root, so they stay correct when the position is reached at another ply
+    int score_to_tt(int score, int ply)
+    {
+        return score >= MATE_BOUND ? score + ply : score <= -MATE_BOUND ? score - ply : score;
+    }
+
+    int score_from_tt(int score, int ply)
+    {
+        return score >= MATE_BOUND ? score - ply : score <= -MATE_BOUND ? score + ply : score;
+    }
+
+    // Mates too far away for a mate score are scored just below the mate scores
+    int tablebase_score(const TablebaseResult& result, int ply)
+    {
+        int score = std::max(MATE_SCORE - ply - result.plies, MATE_BOUND - 1);
+        return result.wdl > 0 ? score : result.wdl < 0 ? -score : 0;
+    }
+
+    // Depth skipping pattern of the helper threads, indexed by helper. Helper i skips the iterations where
+    // ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) is odd, so helpers spread over neighbouring depths instead of all
+    // repeating the main thread's
+    const int SKIP_SIZE[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+    const int SKIP_PHASE[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+    // State shared by the threads of one search
+    struct SharedState
+    {
+        // Padded so threads publishing their counts do not share a cache line
+        struct alignas(64) Counter
+        {
+            std::atomic<unsigned long long> nodes { 0ULL };
+        };
+
+        const SearchLimits& limits;
+        TranspositionTable& table;
+        Clock::time_point start;
+        // Raised by the main thread when the search ends, which also stops the helpers
+        std::atomic<bool> stop { false };
+        // Node count of each thread, published at every limit check
+        std::vector<Counter> counters;
+
+        SharedState(const SearchLimits& limits, TranspositionTable& table, int threads)
+            : limits(limits), table(table), start(Clock::now()), counters(threads) {}
+
+        unsigned long long total_nodes() const
+        {
+            unsigned long long total = 0ULL;
+            for (const Counter& counter : counters)
+                total += counter.nodes.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        long long elapsed_ms() const
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+        }
+    };
+
+    class Searcher
+    {
+    public:
+        Searcher(const Position& root, SharedState& shared, int thread_index, const std::vector<Bitboard>& history)
+            : position(root), shared(shared), limits(shared.limits), table(shared.table), thread_index(thread_index), hashes(history)
+        {
+            hashes.push_back(root.hash);
+            move_history.clear();
+            if (use_nnue)
+                nnue_refresh(position, accumulators[0]);
+        }
+
+        // Iterative deepening of the main thread, which owns the result and decides when the search stops
+        SearchResult run(const SearchCallback& on_iteration);
+        // Iterative deepening of a helper thread. Its results only reach the main thread through the transposition table
+        void run_helper();
+
+    private:
+        Position position;
+        SharedState& shared;
+        const SearchLimits& limits;
+        TranspositionTable& table;
+        // 0 for the main thread
+        int thread_index;
+        // Game history followed by the positions on the current search path, for repetition detection
+        std::vector<Bitboard> hashes;
+
+        unsigned long long nodes = 0ULL;
+        bool stopped = false;
+        // The first iteration always completes so there is a move to return
+        bool can_stop = false;
+
+        // Triangular PV table: pv[ply] holds the best line found from ply, pv_length[ply] entries long
+        Move pv[MAX_PLY][MAX_PLY];
+        int pv_length[MAX_PLY];
+        // Best move of the previous iteration, searched first at the root
+        Move root_move {};
+        bool has_root_move = false;
+
+        // Quiet move ordering: two killers per ply, history and counter moves
+        MoveHistory move_history;
+        Move killers[MAX_PLY][2] {};
+        // Move made at each ply of the current path
+        Move move_stack[MAX_PLY];
+
+        // Network accumulator of the position at each ply, updated from the previous ply's as moves are made
+        bool use_nnue = limits.use_nnue && nnue_loaded();
+        NnueAccumulator accumulators[MAX_PLY + 1];
+
+        int alpha_beta(int depth, int ply, int alpha, int beta);
+        int quiescence(int ply, int alpha, int beta);
+        int static_eval(int ply) const;
+        void make(const Move& move, int ply, UndoInfo& undo);
+        void unmake(const Move& move, const UndoInfo& undo);
+        void update_quiet_stats(const Move& move, int ply, int depth, const Move* quiets_tried, int quiet_count);
+        int aspiration_search(int depth, int previous_score);
+        bool is_draw() const;
+        void check_limits();
+    };
+
+    bool Searcher::is_draw() const
+    {
+        if (position.halfmove_clock >= 100)
+            return true;
+
+        // A single repetition is enough inside the search: whatever was best the first time is best again
+        int last = int(hashes.size()) - 1;
+        int oldest = std::max(0, last - position.halfmove_clock);
+        for (int i = last - 2; i >= oldest; i -= 2)
+        {
+            if (hashes[i] == position.hash)
+                return true;
+        }
+        return false;
+    }
+
+    int Searcher::static_eval(int ply) const
+    {
+        return use_nnue ? nnue_evaluate(position, accumulators[ply]) : evaluate(position);
+    }
+
+    // Plays move at ply, keeping the path hashes and the network accumulator of the next ply in step
+    void Searcher::make(const Move& move, int ply, UndoInfo& undo)
+    {
+        do_move(move, position, undo);
+        hashes.push_back(position.hash);
+        if (use_nnue)
+            nnue_update(accumulators[ply], position, move, accumulators[ply + 1]);
+    }
+
+    void Searcher::unmake(const Move& move, const UndoInfo& undo)
+    {
+        hashes.pop_back();
+        unmake_move(move, undo, position);
+    }
+
+    void Searcher::check_limits()
+    {
+        shared.counters[thread_index].nodes.store(nodes, std::memory_order_relaxed);
+
+        if (shared.stop.load(std::memory_order_relaxed))
+        {
+            stopped = true;
+            return;
+        }
+
+        if (thread_index != 0 || !can_stop)
+            return;
+
+        if ((limits.stop && limits.stop->load(std::memory_order_relaxed)) ||
+            (limits.nodes && shared.total_nodes() >= limits.nodes) ||
+            (limits.time_ms && shared.elapsed_ms() >= limits.time_ms))
+        {
+            shared.stop.store(true, std::memory_order_relaxed);
+            stopped = true;
+        }
+    }
+
+    // Fail-soft principal variation search. Only the first move is searched with the full window; the rest are
+    // proven worse with a null window and only re-searched when that fails
+    int Searcher::alpha_beta(int depth, int ply, int alpha, int beta)
+    {
+        pv_length[ply] = ply;
+
+        if (++nodes % CHECK_INTERVAL == 0 || (limits.nodes && nodes >= limits.nodes))
+            check_limits();
+        if (stopped)
+            return 0;
+
+        if (ply && is_draw())
+            return 0;
+
+        // Endgames of the loaded tablebases need no search. The root is still searched, so there is a move to play
+        TablebaseResult tablebase_result;
+        if (ply && pop_count(position.all_occupancy) <= tablebase_max_pieces() && tablebase_probe(position, tablebase_result))
+            return tablebase_score(tablebase_result, ply);
+
+        if (depth <= 0 || ply >= MAX_PLY - 1)
+            return quiescence(ply, alpha, beta);
+
+        // Outside the principal variation a deep enough stored bound settles the node. PV nodes are always searched so the PV stays intact
+        bool pv_node = beta - alpha > 1;
+        TTEntry entry;
+        bool tt_hit = table.probe(position.hash, entry);
+
+        if (tt_hit && ply && !pv_node && entry.depth >= depth)
+        {
+            int tt_score = score_from_tt(entry.score, ply);
+            if (entry.bound == BOUND_EXACT ||
+                (entry.bound == BOUND_LOWER && tt_score >= beta) ||
+                (entry.bound == BOUND_UPPER && tt_score <= alpha))
+                return tt_score;
+        }
+
+        bool in_check = is_king_in_check(position, position.color_to_move ^ 1);
+
+        // Check extension, so a forced sequence of checks is not cut off at the horizon
+        if (in_check)
+            depth++;
+
+        const Move* tt_move = ply == 0 && has_root_move ? &root_move : tt_hit && entry.has_move ? &entry.move : nullptr;
+        const Move* counter_move = nullptr;
+        if (ply)
+        {
+            const Move& previous = move_stack[ply - 1];
+            counter_move = &move_history.counter_moves[previous.color][previous.piece_type][previous.to];
+        }
+
+        MovePicker picker(position, tt_move, killers[ply], counter_move, move_history);
+
+        int original_alpha = alpha;
+        int best_score = -INFINITE_SCORE;
+        Move best_move {};
+        // Quiets searched before a cutoff lose history score
+        Move quiets_tried[64];
+        int quiet_count = 0;
+        int move_count = 0;
+        Move move;
+
+        while (picker.next(move))
+        {
+            bool quiet = move.captured_type == -1 && move.promotion == -1;
+            move_count++;
+            move_stack[ply] = move;
+
+            UndoInfo undo;
+            make(move, ply, undo);
+
+            int score;
+            if (move_count == 1)
+                score = -alpha_beta(depth - 1, ply + 1, -beta, -alpha);
+            else
+            {
+                score = -alpha_beta(depth - 1, ply + 1, -alpha - 1, -alpha);
+                if (score > alpha && score < beta)
+                    score = -alpha_beta(depth - 1, ply + 1, -beta, -alpha);
+            }
+
+            unmake(move, undo);
+
+            if (stopped)
+                return 0;
+
+            if (score > best_score)
+            {
+                best_score = score;
+                best_move = move;
+
+                if (score > alpha)
+                {
+                    alpha = score;
+
+                    pv[ply][ply] = move;
+                    for (int next = ply + 1; next < pv_length[ply + 1]; ++next)
+                        pv[ply][next] = pv[ply + 1][next];
+                    pv_length[ply] = pv_length[ply + 1];
+
+                    if (alpha >= beta)
+                    {
+                        if (quiet)
+                            update_quiet_stats(move, ply, depth, quiets_tried, quiet_count);
+                        break;
+                    }
+                }
+            }
+
+            if (quiet && quiet_count < 64)
+                quiets_tried[quiet_count++] = move;
+        }
+
+        if (!move_count)
+            return in_check ? -MATE_SCORE + ply : 0;
+
+        // Only a move that raised alpha is known to be best. After a fail low every move was merely bounded
+        Bound bound = best_score >= beta ? BOUND_LOWER : best_score > original_alpha ? BOUND_EXACT : BOUND_UPPER;
+        table.store(position.hash, bound == BOUND_UPPER ? nullptr : &best_move, depth, bound, score_to_tt(best_score, ply));
+
+        return best_score;
+    }
+
+    // Searches captures until the position is quiet, so the static evaluation is never taken in the middle of an
+    // exchange. The side to move may stand pat on the evaluation instead of capturing, except in check, where every
+    // evasion is searched. Captures that lose material by static exchange evaluation are skipped
+    int Searcher::quiescence(int ply, int alpha, int beta)
+    {
+        pv_length[ply] = ply;
+
+        if (++nodes % CHECK_INTERVAL == 0 || (limits.nodes && nodes >= limits.nodes))
+            check_limits();
+        if (stopped)
+            return 0;
+
+        if (is_draw())
+            return 0;
+
+        if (ply >= MAX_PLY - 1)
+            return static_eval(ply);
+
+        TTEntry entry;
+        bool tt_hit = table.probe(position.hash, entry);
+        const Move* tt_move = tt_hit && entry.has_move ? &entry.move : nullptr;
+
+        bool in_check = is_king_in_check(position, position.color_to_move ^ 1);
+        int best_score = -INFINITE_SCORE;
+
+        if (!in_check)
+        {
+            best_score = static_eval(ply);
+            if (best_score >= beta)
+                return best_score;
+            alpha = std::max(alpha, best_score);
+        }
+
+        MovePicker picker = in_check ? MovePicker(position, tt_move, killers[ply], nullptr, move_history)
+                                     : MovePicker(position, tt_move, move_history);
+        int move_count = 0;
+        Move move;
+
+        while (picker.next(move))
+        {
+            move_count++;
+            move_stack[ply] = move;
+
+            UndoInfo undo;
+            make(move, ply, undo);
+
+            int score = -quiescence(ply + 1, -beta, -alpha);
+
+            unmake(move, undo);
+
+            if (stopped)
+                return 0;
+
+            if (score > best_score)
+            {
+                best_score = score;
+
+                if (score > alpha)
+                {
+                    alpha = score;
+
+                    pv[ply][ply] = move;
+                    for (int next = ply + 1; next < pv_length[ply + 1]; ++next)
+                        pv[ply][next] = pv[ply + 1][next];
+                    pv_length[ply] = pv_length[ply + 1];
+
+                    if (alpha >= beta)
+                        break;
+                }
+            }
+        }
+
+        if (in_check && !move_count)
+            return -MATE_SCORE + ply;
+
+        return best_score;
+    }
+
+    void Searcher::update_quiet_stats(const Move& move, int ply, int depth, const Move* quiets_tried, int quiet_count)
+    {
+        if (killers[ply][0] != move)
+        {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = move;
+        }
+
+        move_history.update(move, quiets_tried, quiet_count, depth);
+
+        if (ply)
+        {
+            const Move& previous = move_stack[ply - 1];
+            move_history.counter_moves[previous.color][previous.piece_type][previous.to] = move;
+        }
+    }
+
+    // Searches the root with a narrow window centred on the previous score once it has settled. Outside it the
+    // search fails and the window widens
+    int Searcher::aspiration_search(int depth, int previous_score)
+    {
+        int delta = ASPIRATION_DELTA;
+        int alpha = -INFINITE_SCORE;
+        int beta = INFINITE_SCORE;
+
+        if (depth >= 4 && !is_mate_score(previous_score))
+        {
+            alpha = std::max(previous_score - delta, -INFINITE_SCORE);
+            beta = std::min(previous_score + delta, INFINITE_SCORE);
+        }
+
+        while (true)
+        {
+            int score = alpha_beta(depth, 0, alpha, beta);
+            if (stopped)
+                return 0;
+
+            if (score <= alpha)
+                alpha = std::max(alpha - delta, -INFINITE_SCORE);
+            else if (score >= beta)
+                beta = std::min(beta + delta, INFINITE_SCORE);
+            else
+                return score;
+
+            delta *= 2;
+        }
+    }
+
+    SearchResult Searcher::run(const SearchCallback& on_iteration)
+    {
+        SearchResult result;
+
+        MoveList root_moves;
+        generate_legal(position, root_moves);
+        if (!root_moves.size)
+        {
+            result.score = is_king_in_check(position, position.color_to_move ^ 1) ? -MATE_SCORE : 0;
+            return result;
+        }
+
+        // Fallback should the search be stopped before anything is known
+        result.best_move = root_moves[0];
+        result.has_move = true;
+        result.pv = { root_moves[0] };
+
+        int score = 0;
+
+        for (int depth = 1; depth <= limits.depth; ++depth)
+        {
+            score = aspiration_search(depth, score);
+            if (stopped)
+                break;
+
+            can_stop = true;
+            root_move = pv[0][0];
+            has_root_move = true;
+            shared.counters[thread_index].nodes.store(nodes, std::memory_order_relaxed);
+
+            result.best_move = pv[0][0];
+            result.score = score;
+            result.depth = depth;
+            result.pv.assign(pv[0], pv[0] + pv_length[0]);
+            result.nodes = shared.total_nodes();
+            result.time_ms = shared.elapsed_ms();
+            result.nps = result.time_ms ? result.nodes * 1000 / result.time_ms : result.nodes * 1000;
+            result.hashfull = table.hashfull();
+
+            if (on_iteration)
+                on_iteration(result);
+
+            // A mate that fits in the searched depth cannot improve
+            if (is_mate_score(score) && MATE_SCORE - std::abs(score) <= depth)
+                break;
+
+            // The next iteration would take several times as long as this one, so do not start it past half the budget
+            if (limits.time_ms && result.time_ms >= limits.time_ms / 2)
+                break;
+
+            check_limits();
+            if (stopped)
+                break;
+        }
+
+        shared.counters[thread_index].nodes.store(nodes, std::memory_order_relaxed);
+        return result;
+    }
+
+    void Searcher::run_helper()
+    {
+        can_stop = true;
+
+        const int skip_size = SKIP_SIZE[(thread_index - 1) % 20];
+        const int skip_phase = SKIP_PHASE[(thread_index - 1) % 20];
+        int score = 0;
+
+        for (int depth = 1; depth <= limits.depth; ++depth)
+        {
+            if (((depth + skip_phase) / skip_size) % 2)
+                continue;
+
+            score = aspiration_search(depth, score);
+            if (stopped)
+                break;
+
+            root_move = pv[0][0];
+            has_root_move = true;
+        }
+
+        shared.counters[thread_index].nodes.store(nodes, std::memory_order_relaxed);
+    }
+}
+
+SearchResult search(const Position& position, const SearchLimits& limits, TranspositionTable& table, const std::vector<Bitboard>& history, const SearchCallback& on_iteration)
+{
+    table.new_search();
+
+    int threads = std::max(1, limits.threads);
+    SharedState shared(limits, table, threads);
+
+    // Lazy SMP: helpers search the same root with staggered depths and share what they find through the table.
+    // The PV tables are large, so searchers live on the heap rather than a thread's stack
+    std::unique_ptr<WorkStealingPool> pool;
+    if (threads > 1)
+    {
+        pool = std::make_unique<WorkStealingPool>(threads - 1);
+        for (int i = 1; i < threads; ++i)
+        {
+            pool->submit([&position, &shared, &history, i](int)
+            {
+                auto helper = std::make_unique<Searcher>(position, shared, i, history);
+                helper->run_helper();
+            }, i - 1);
+        }
+    }
+
+    auto searcher = std::make_unique<Searcher>(position, shared, 0, history);
+    SearchResult result = searcher->run(on_iteration);
+
+    shared.stop.store(true, std::memory_order_relaxed);
+    if (pool)
+        pool->wait();
+
+    for (const SharedState::Counter& counter : shared.counters)
+        result.thread_nodes.push_back(counter.nodes.load(std::memory_order_relaxed));
+
+    result.nodes = shared.total_nodes();
+    result.time_ms = shared.elapsed_ms();
+    result.nps = result.time_ms ? result.nodes * 1000 / result.time_ms : result.nodes * 1000;
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "position.h"
+#include "tt.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+constexpr int MAX_PLY = 128;
+constexpr int MATE_SCORE = 32000;
+constexpr int INFINITE_SCORE = 32001;
+// Scores at or beyond this are mates, MATE_SCORE minus the number of plies to mate
+constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY;
+
+// The search stops at whichever limit is reached first. Zero means no limit
+struct SearchLimits
+{
+    int depth = MAX_PLY - 1;
+    unsigned long long nodes = 0ULL;
+    long long time_ms = 0;
+    // Threads searching the position together (Lazy SMP). Not a limit, but set per search like the limits
+    int threads = 1;
+    // Evaluate with the loaded NNUE network, when there is one, rather than the hand-written evaluation
+    bool use_nnue = true;
+    // Set from another thread to stop the search. The last completed iteration is returned
+    const std::atomic<bool>* stop = nullptr;
+};
+
+struct SearchResult
+{
+    Move best_move {};
+    // False when the position has no legal moves
+    bool has_move = false;
+    // Centipawns from the side to move's point of view, or a mate score
+    int score = 0;
+    int depth = 0;
+    unsigned long long nodes = 0ULL;
+    long long time_ms = 0;
+    unsigned long long nps = 0ULL;
+    // Permille of the transposition table in use
+    int hashfull = 0;
+    // Principal variation, starting with best_move
+    std::vector<Move> pv;
+    // Nodes searched by each thread, the main thread first. Filled in once the search is over
+    std::vector<unsigned long long> thread_nodes;
+};
+
+// Called after each completed iteration with the result at that depth
+using SearchCallback = std::function<void(const SearchResult&)>;
+
+// Iterative deepening principal variation alpha-beta search with aspiration windows. Results are cached in table, which
+// keeps them across searches and is shared by the helper threads when limits.threads is above one. history holds the hashes of the game positions before this one, so repetitions of them are scored as draws
+SearchResult search(const Position& position, const SearchLimits& limits, TranspositionTable& table, const std::vector<Bitboard>& history = {}, const SearchCallback& on_iteration = nullptr);
+
+inline bool is_mate_score(int score) { return score >= MATE_BOUND || score <= -MATE_BOUND; }
+// Moves to mate of a mate score, negative when the side to move is getting mated
+inline int mate_in_moves(int score) { return score > 0 ? (MATE_SCORE - score + 1) / 2 : -(MATE_SCORE + score + 1) / 2; }
+
+#endif // SEARCH_H
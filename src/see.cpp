@@ -0,0 +1,90 @@
+#include "see.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include <algorithm>
+
+namespace
+{
+    // Piece values for the exchange, with the king worth more than everything else so it never captures into a defended square
+    int see_value(int type)
+    {
+        return type == KING ? 20000 : PIECE_VALUES[type];
+    }
+
+    // Cheapest to most valuable, the order attackers are used in
+    const PieceType ATTACKER_ORDER[6] = { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+}
+
+int see(const Position& position, const Move& move)
+{
+    Square to = move.to;
+    Bitboard occupancy = position.all_occupancy ^ (1ULL << move.from);
+
+    // gain[d] is the balance for the side making capture d if the exchange stops right after it
+    int gain[32];
+    int d = 0;
+
+    if (move.is_en_passant)
+    {
+        occupancy ^= 1ULL << (move.color == WHITE ? to - 8 : to + 8);
+        gain[0] = PIECE_VALUES[PAWN];
+    }
+    else
+        gain[0] = move.captured_type != -1 ? PIECE_VALUES[move.captured_type] : 0;
+
+    int on_square = move.piece_type;
+    if (move.promotion != -1)
+    {
+        gain[0] += PIECE_VALUES[move.promotion] - PIECE_VALUES[PAWN];
+        on_square = move.promotion;
+    }
+
+    Bitboard diagonal = position.pieces[WHITE][BISHOP] | position.pieces[BLACK][BISHOP] | position.pieces[WHITE][QUEEN] | position.pieces[BLACK][QUEEN];
+    Bitboard straight = position.pieces[WHITE][ROOK] | position.pieces[BLACK][ROOK] | position.pieces[WHITE][QUEEN] | position.pieces[BLACK][QUEEN];
+
+    Bitboard attackers = (attacked_by(position, to, WHITE, occupancy) | attacked_by(position, to, BLACK, occupancy)) & occupancy;
+    int side = move.color ^ 1;
+
+    while (d < 31)
+    {
+        Bitboard side_attackers = attackers & position.occupancy[side];
+        if (!side_attackers)
+            break;
+
+        int type = KING;
+        Bitboard from_bb = 0ULL;
+        for (PieceType candidate : ATTACKER_ORDER)
+        {
+            Bitboard pieces = side_attackers & position.pieces[side][candidate];
+            if (pieces)
+            {
+                type = candidate;
+                from_bb = pieces & (0ULL - pieces);
+                break;
+            }
+        }
+
+        d++;
+        gain[d] = see_value(on_square) - gain[d - 1];
+
+        occupancy ^= from_bb;
+        // Sliders lined up behind the piece that just captured now reach the square
+        if (type == PAWN || type == BISHOP || type == QUEEN)
+            attackers |= bishop_attacks(occupancy, to) & diagonal;
+        if (type == ROOK || type == QUEEN)
+            attackers |= rook_attacks(occupancy, to) & straight;
+        attackers &= occupancy;
+
+        on_square = type;
+        side ^= 1;
+    }
+
+    // Each side picks the better of stopping or recapturing, from the last capture back to the first
+    while (d > 0)
+    {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
+
+    return gain[0];
+}
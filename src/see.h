@@ -0,0 +1,11 @@
+#ifndef SEE_H
+#define SEE_H
+
+#include "position.h"
+
+// Static exchange evaluation: material gained by move once every capture on its destination square has been
+// played out, each side capturing with its least valuable attacker and free to stop when continuing would lose.
+// Attackers behind others on a line (x-rays) join in as the pieces in front leave. Pins are ignored
+int see(const Position& position, const Move& move);
+
+#endif // SEE_H
@@ -0,0 +1,307 @@
+#include "tablebase.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const char MAGIC[8] = { 'B', 'B', 'C', 'T', 'B', '0', '0', '1' };
+    const size_t HEADER_SIZE = 32;
+    const size_t NAME_SIZE = 16;
+
+    // Letters of the pieces other than the king, in the order they are named and given slots
+    const char PIECE_LETTERS[] = "QRBNP";
+    const PieceType LETTER_TYPES[] = { QUEEN, ROOK, BISHOP, KNIGHT, PAWN };
+    // Only used to tell the stronger side
+    const int LETTER_VALUES[] = { 9, 5, 3, 3, 1 };
+
+    // Bits of the material key per color
+    const int KEY_COLOR_BITS = 20;
+
+    struct Table
+    {
+        Endgame endgame;
+        MappedFile file;
+        int bits = 0;
+    };
+
+    std::vector<std::unique_ptr<Table>> tables;
+    int max_pieces = 0;
+
+    uint64_t flip_key(uint64_t key)
+    {
+        const uint64_t mask = (1ULL << KEY_COLOR_BITS) - 1;
+        return ((key & mask) << KEY_COLOR_BITS) | (key >> KEY_COLOR_BITS);
+    }
+
+    int side_value(const std::string& side)
+    {
+        int value = 0;
+        for (char letter : side)
+        {
+            const char* found = std::strchr(PIECE_LETTERS, letter);
+            if (found && *found)
+                value += LETTER_VALUES[found - PIECE_LETTERS];
+        }
+        return value;
+    }
+
+    // Sorts the pieces after the king and puts the stronger side first
+    std::string canonical_name(std::string white, std::string black)
+    {
+        auto order = [](char a, char b) { return std::strchr(PIECE_LETTERS, a) < std::strchr(PIECE_LETTERS, b); };
+        std::sort(white.begin() + 1, white.end(), order);
+        std::sort(black.begin() + 1, black.end(), order);
+
+        int white_value = side_value(white), black_value = side_value(black);
+        if (black_value > white_value || (black_value == white_value && black.size() > white.size()) ||
+            (black_value == white_value && black.size() == white.size() && black < white))
+            std::swap(white, black);
+        return white + "v" + black;
+    }
+
+    std::string side_name(const Position& position, int color)
+    {
+        std::string side = "K";
+        for (int letter = 0; PIECE_LETTERS[letter]; ++letter)
+            side.append(pop_count(position.pieces[color][LETTER_TYPES[letter]]), PIECE_LETTERS[letter]);
+        return side;
+    }
+}
+
+bool parse_endgame(const std::string& name, Endgame& endgame, std::string& error)
+{
+    size_t split = name.find('v');
+    std::string white = name.substr(0, split);
+    std::string black = split == std::string::npos ? "" : name.substr(split + 1);
+
+    auto valid_side = [](const std::string& side)
+    {
+        return !side.empty() && side[0] == 'K' && side.find_first_not_of(PIECE_LETTERS, 1) == std::string::npos;
+    };
+
+    if (!valid_side(white) || !valid_side(black) || int(white.size() + black.size()) > TB_MAX_PIECES)
+    {
+        error = name + ": expected two kings and at most " + std::to_string(TB_MAX_PIECES - 2) + " other pieces, e.g. KQvKR";
+        return false;
+    }
+
+    endgame = Endgame {};
+    endgame.name = canonical_name(white, black);
+    split = endgame.name.find('v');
+
+    endgame.colors[0] = WHITE;
+    endgame.types[0] = KING;
+    endgame.colors[1] = BLACK;
+    endgame.types[1] = KING;
+    endgame.piece_count = 2;
+
+    for (size_t i = 1; i < endgame.name.size(); ++i)
+    {
+        if (i == split || i == split + 1)
+            continue;
+
+        Color color = i < split ? WHITE : BLACK;
+        PieceType type = LETTER_TYPES[std::strchr(PIECE_LETTERS, endgame.name[i]) - PIECE_LETTERS];
+        endgame.colors[endgame.piece_count] = color;
+        endgame.types[endgame.piece_count] = type;
+        endgame.piece_count++;
+        endgame.key += 1ULL << (4 * (5 * color + type));
+    }
+    return true;
+}
+
+std::string endgame_name(const Position& position)
+{
+    return canonical_name(side_name(position, WHITE), side_name(position, BLACK));
+}
+
+uint64_t material_key(const Position& position)
+{
+    uint64_t key = 0;
+    for (int color = WHITE; color <= BLACK; ++color)
+        for (int type = PAWN; type < KING; ++type)
+            key += uint64_t(pop_count(position.pieces[color][type])) << (4 * (5 * color + type));
+    return key;
+}
+
+size_t tb_entry_count(const Endgame& endgame)
+{
+    size_t count = 2 * 32;
+    for (int i = 1; i < endgame.piece_count; ++i)
+        count *= 64;
+    return count;
+}
+
+size_t tb_index(const Endgame& endgame, int color_to_move, const int* squares)
+{
+    // Without castling or pawns moving sideways, a position and its mirror image across the d/e file line are the same
+    int mirror = (squares[0] & 7) >= 4 ? 7 : 0;
+    int king = squares[0] ^ mirror;
+
+    size_t index = size_t(color_to_move) * 32 + (king >> 3) * 4 + (king & 7);
+    for (int i = 1; i < endgame.piece_count; ++i)
+        index = index * 64 + size_t(squares[i] ^ mirror);
+    return index;
+}
+
+void tb_squares(const Endgame& endgame, size_t index, int& color_to_move, int* squares)
+{
+    for (int i = endgame.piece_count - 1; i > 0; --i)
+    {
+        squares[i] = int(index % 64);
+        index /= 64;
+    }
+    int king = int(index % 32);
+    squares[0] = (king / 4) * 8 + king % 4;
+    color_to_move = int(index / 32);
+}
+
+bool tb_position(const Endgame& endgame, int color_to_move, const int* squares, Position& position)
+{
+    position = Position {};
+    position.color_to_move = Color(color_to_move);
+    position.castling_rights[WHITE] = NONE;
+    position.castling_rights[BLACK] = NONE;
+
+    Bitboard occupied = 0ULL;
+    for (int i = 0; i < endgame.piece_count; ++i)
+    {
+        Bitboard square = 1ULL << squares[i];
+        if (occupied & square)
+            return false;
+        if (endgame.types[i] == PAWN && (square & (FIRST_RANK | EIGHT_RANK)))
+            return false;
+
+        occupied |= square;
+        position.pieces[endgame.colors[i]][endgame.types[i]] |= square;
+    }
+
+    update_occupancies(position);
+    return true;
+}
+
+bool tb_position_index(const Endgame& endgame, const Position& position, size_t& index)
+{
+    uint64_t key = material_key(position);
+    int flip;
+    if (key == endgame.key)
+        flip = 0;
+    else if (flip_key(key) == endgame.key)
+        flip = 1;
+    else
+        return false;
+
+    // Pieces of one kind take their slots lowest square first
+    Bitboard remaining[2][6];
+    std::memcpy(remaining, position.pieces, sizeof(remaining));
+
+    int squares[TB_MAX_PIECES];
+    for (int i = 0; i < endgame.piece_count; ++i)
+    {
+        Bitboard& pieces = remaining[endgame.colors[i] ^ flip][endgame.types[i]];
+        squares[i] = bit_scan_forward(pieces) ^ (flip ? 56 : 0);
+        pieces &= pieces - 1;
+    }
+
+    index = tb_index(endgame, position.color_to_move ^ flip, squares);
+    return true;
+}
+
+int tablebase_load(const std::string& directory, std::string& error)
+{
+    std::error_code code;
+    std::filesystem::directory_iterator entries(directory, code);
+    if (code)
+    {
+        error = "cannot open " + directory;
+        return 0;
+    }
+
+    std::vector<std::unique_ptr<Table>> loaded;
+    int loaded_pieces = 0;
+
+    for (const std::filesystem::directory_entry& entry : entries)
+    {
+        if (entry.path().extension() != ".bbtb")
+            continue;
+
+        std::string path = entry.path().string();
+        auto table = std::make_unique<Table>();
+        if (!table->file.open(path, error))
+            continue;
+
+        const unsigned char* bytes = table->file.data();
+        size_t size = table->file.size();
+        char name[NAME_SIZE + 1] = {};
+        uint32_t entry_count = 0, bits = 0;
+        if (size >= HEADER_SIZE)
+        {
+            std::memcpy(name, bytes + 8, NAME_SIZE);
+            std::memcpy(&entry_count, bytes + 24, sizeof(entry_count));
+            std::memcpy(&bits, bytes + 28, sizeof(bits));
+        }
+
+        std::string parse_error;
+        if (size < HEADER_SIZE || std::memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0 || !parse_endgame(name, table->endgame, parse_error) ||
+            entry_count != tb_entry_count(table->endgame) || bits < 1 || bits > 8 ||
+            size != HEADER_SIZE + (size_t(entry_count) * bits + 7) / 8 + 1)
+        {
+            error = path + " is not a tablebase";
+            continue;
+        }
+
+        table->bits = int(bits);
+        loaded_pieces = std::max(loaded_pieces, table->endgame.piece_count);
+        loaded.push_back(std::move(table));
+    }
+
+    if (loaded.empty())
+    {
+        if (error.empty())
+            error = "no tablebases in " + directory;
+        return 0;
+    }
+
+    tables = std::move(loaded);
+    max_pieces = loaded_pieces;
+    return int(tables.size());
+}
+
+void tablebase_unload()
+{
+    tables.clear();
+    max_pieces = 0;
+}
+
+int tablebase_max_pieces()
+{
+    return max_pieces;
+}
+
+bool tablebase_probe(const Position& position, TablebaseResult& result)
+{
+    if (!max_pieces || pop_count(position.all_occupancy) > max_pieces || position.en_passant != -1 ||
+        position.castling_rights[WHITE] != NONE || position.castling_rights[BLACK] != NONE)
+        return false;
+
+    for (const std::unique_ptr<Table>& table : tables)
+    {
+        size_t index;
+        if (!tb_position_index(table->endgame, position, index))
+            continue;
+
+        // An entry is at most 8 bits, so it spans at most two bytes
+        size_t bit = index * size_t(table->bits);
+        const unsigned char* bytes = table->file.data() + HEADER_SIZE + bit / 8;
+        unsigned value = ((bytes[0] | (unsigned(bytes[1]) << 8)) >> (bit % 8)) & ((1u << table->bits) - 1);
+
+        result.plies = value ? int(value) - 1 : 0;
+        result.wdl = !value ? 0 : result.plies % 2 ? 1 : -1;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "position.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+    Endgame tablebases: the result and distance to mate of every position of an endgame of two kings and at most two other
+    pieces, built offline by retrograde analysis (tbgen.h, tools/tbgen.cpp) and memory-mapped for probing.
+
+    Positions are indexed by side to move, the white king's square mirrored onto files a to d, then the square of every
+    other piece. Castling and en passant are not part of an endgame. .bbtb file layout, little endian:
+
+        0   char[8]   magic "BBCTB001"
+        8   char[16]  endgame name, e.g. "KQvKR", NUL padded
+        24  uint32    entry count
+        28  uint32    bits per entry
+        32            entries, packed from the lowest bit of each byte up, and one byte of padding
+
+    An entry is 0 for a draw or an impossible position, otherwise 1 + the plies to mate: odd plies when the side to move
+    mates, even plies when it is mated.
+*/
+
+constexpr int TB_MAX_PIECES = 4;
+// Longest distance to mate an entry can hold
+constexpr int TB_MAX_PLIES = 250;
+
+// Pieces of an endgame. Slots 0 and 1 are the white and the black king. White is the side named first, the stronger;
+// positions with the colors the other way round are looked up with the board flipped
+struct Endgame
+{
+    std::string name;
+    int piece_count = 0;
+    Color colors[TB_MAX_PIECES];
+    PieceType types[TB_MAX_PIECES];
+    // Count of every piece but the kings, see material_key
+    uint64_t key = 0;
+};
+
+// Parses a name such as "KQvK" or "KRvKB" in either order. False, with error set, unless it is two kings and at most
+// two other pieces
+bool parse_endgame(const std::string& name, Endgame& endgame, std::string& error);
+// Canonical name of the endgame of a position, e.g. "KRvKB" whichever side has the rook
+std::string endgame_name(const Position& position);
+// Four bits per color and piece type, kings excluded
+uint64_t material_key(const Position& position);
+
+size_t tb_entry_count(const Endgame& endgame);
+// squares holds the square of each slot
+size_t tb_index(const Endgame& endgame, int color_to_move, const int* squares);
+void tb_squares(const Endgame& endgame, size_t index, int& color_to_move, int* squares);
+// Position of the squares. False when two pieces share a square or a pawn stands on the first or last rank
+bool tb_position(const Endgame& endgame, int color_to_move, const int* squares, Position& position);
+// Index of a position of the endgame, or of its color-flipped twin. False when the position is not of this endgame
+bool tb_position_index(const Endgame& endgame, const Position& position, size_t& index);
+
+// Loads every .bbtb file of a directory, replacing the tables loaded before. Returns the number of tables loaded,
+// 0 with error set when none could be
+int tablebase_load(const std::string& directory, std::string& error);
+void tablebase_unload();
+// Most pieces on the board in any loaded table, 0 when none are loaded
+int tablebase_max_pieces();
+
+struct TablebaseResult
+{
+    // 1 when the side to move mates, -1 when it is mated, 0 for a draw
+    int wdl = 0;
+    // Plies to mate with best play from both sides
+    int plies = 0;
+};
+
+// False when no loaded table covers the position or it still has castling rights or an en passant square
+bool tablebase_probe(const Position& position, TablebaseResult& result);
+
+#endif // TABLEBASE_H
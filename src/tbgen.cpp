@@ -0,0 +1,384 @@
+#include "tbgen.h"
+#include "moveexec.h"
+#include "movegen.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+    // Entry states while building. A decided entry holds DECIDED + the plies to mate
+    const uint8_t UNKNOWN = 0;
+    const uint8_t ILLEGAL = 1;
+    const uint8_t DRAW = 2;
+    const uint8_t DECIDED = 3;
+
+    // Entries per pool task
+    const size_t CHUNK = 1 << 14;
+
+    const char MAGIC[8] = { 'B', 'B', 'C', 'T', 'B', '0', '0', '1' };
+    const size_t NAME_SIZE = 16;
+
+    // Runs work(begin, end) over every chunk of the table on the pool and waits for all of them
+    template<typename Work>
+    void for_each_chunk(WorkStealingPool& pool, size_t entries, const Work& work)
+    {
+        for (size_t begin = 0; begin < entries; begin += CHUNK)
+            pool.submit([&work, begin, entries](int) { work(begin, std::min(entries, begin + CHUNK)); });
+        pool.wait();
+    }
+
+    // Endgames one capture or promotion away, bare kings excluded
+    std::vector<std::string> conversions(const Endgame& endgame)
+    {
+        size_t split = endgame.name.find('v');
+        std::string sides[2] = { endgame.name.substr(0, split), endgame.name.substr(split + 1) };
+        std::vector<std::string> names;
+
+        for (int side = 0; side < 2; ++side)
+        {
+            for (size_t i = 1; i < sides[side].size(); ++i)
+            {
+                std::string changed[2] = { sides[0], sides[1] };
+                std::vector<std::string> variants;
+
+                changed[side].erase(i, 1);
+                variants.push_back(changed[0] + "v" + changed[1]);
+
+                if (sides[side][i] == 'P')
+                {
+                    for (char promotion : std::string("QRBN"))
+                    {
+                        changed[side] = sides[side];
+                        changed[side][i] = promotion;
+                        variants.push_back(changed[0] + "v" + changed[1]);
+                    }
+                }
+
+                for (const std::string& variant : variants)
+                {
+                    Endgame child;
+                    std::string error;
+                    if (parse_endgame(variant, child, error) && child.piece_count > 2 &&
+                        std::find(names.begin(), names.end(), child.name) == names.end())
+                        names.push_back(child.name);
+                }
+            }
+        }
+        return names;
+    }
+
+    // Squares a piece now on square can have come from by a move that captured nothing and did not promote
+    Bitboard origins(PieceType type, int color, int square, Bitboard occupied)
+    {
+        Bitboard empty = ~occupied;
+        Bitboard piece = 1ULL << square;
+
+        switch (type)
+        {
+        case KING:   return king_attacks(Square(square)) & empty;
+        case KNIGHT: return knight_attacks(Square(square)) & empty;
+        case BISHOP: return bishop_attacks(occupied, Square(square)) & empty;
+        case ROOK:   return rook_attacks(occupied, Square(square)) & empty;
+        case QUEEN:  return queen_attacks(occupied, Square(square)) & empty;
+        case PAWN:
+        {
+            Bitboard single = (color == WHITE ? south_one(piece) : north_one(piece)) & empty;
+            Bitboard result = single & ~(FIRST_RANK | EIGHT_RANK);
+            if (piece & (color == WHITE ? FORTH_RANK : FIFTH_RANK))
+                result |= (color == WHITE ? south_one(single) : north_one(single)) & empty;
+            return result;
+        }
+        }
+        return 0ULL;
+    }
+
+    class Builder
+    {
+    public:
+        Builder(const Endgame& endgame, const std::vector<const GeneratedTable*>& children)
+            : endgame(endgame), children(children), entries(tb_entry_count(endgame)),
+              state(new std::atomic<uint8_t>[entries]()), marked(new std::atomic<uint8_t>[entries]()), wake(entries, 0)
+        {
+        }
+
+        void build(WorkStealingPool& pool, GeneratedTable& table);
+
+    private:
+        const Endgame& endgame;
+        const std::vector<const GeneratedTable*>& children;
+        size_t entries;
+        std::unique_ptr<std::atomic<uint8_t>[]> state;
+        // Entries to look at in the coming pass
+        std::unique_ptr<std::atomic<uint8_t>[]> marked;
+        // Pass at which a capture or promotion into another table may decide the entry, 0 for none
+        std::vector<uint8_t> wake;
+
+        // Entry, in the file's encoding, of a position one capture or promotion away
+        uint8_t child_value(const Position& position) const;
+        void initialize(size_t index);
+        void mark_predecessors(size_t index);
+        // True when the entry was decided in pass
+        bool decide(size_t index, int pass);
+    };
+
+    uint8_t Builder::child_value(const Position& position) const
+    {
+        size_t index;
+        for (const GeneratedTable* child : children)
+            if (tb_position_index(child->endgame, position, index))
+                return child->values[index];
+        // Bare kings
+        return 0;
+    }
+
+    void Builder::initialize(size_t index)
+    {
+        int color_to_move;
+        int squares[TB_MAX_PIECES];
+        tb_squares(endgame, index, color_to_move, squares);
+
+        Position position;
+        if (!tb_position(endgame, color_to_move, squares, position) ||
+            is_attacked(position, Square(squares[color_to_move ^ 1]), color_to_move))
+        {
+            state[index].store(ILLEGAL, std::memory_order_relaxed);
+            return;
+        }
+
+        MoveList moves;
+        generate_legal(position, moves);
+        if (!moves.size)
+        {
+            bool in_check = is_attacked(position, Square(squares[color_to_move]), color_to_move ^ 1);
+            state[index].store(in_check ? DECIDED : DRAW, std::memory_order_relaxed);
+            return;
+        }
+
+        int win = 0, loss = 0;
+        bool drawn = false;
+        for (const Move& move : moves)
+        {
+            if (move.captured_type == -1 && move.promotion == -1)
+                continue;
+
+            Position child = position;
+            do_move(move, child);
+            int value = child_value(child);
+            if (!value)
+                drawn = true;
+            else if ((value - 1) % 2 == 0)
+                win = win ? std::min(win, value) : value;
+            else
+                loss = std::max(loss, value);
+        }
+
+        // A losing reply is taken as soon as it is known; otherwise every reply must lose, the slowest last
+        wake[index] = uint8_t(win ? win : drawn ? 0 : loss);
+    }
+
+    void Builder::mark_predecessors(size_t index)
+    {
+        int color_to_move;
+        int squares[TB_MAX_PIECES];
+        tb_squares(endgame, index, color_to_move, squares);
+
+        Bitboard occupied = 0ULL;
+        for (int i = 0; i < endgame.piece_count; ++i)
+            occupied |= 1ULL << squares[i];
+
+        int mover = color_to_move ^ 1;
+        for (int i = 0; i < endgame.piece_count; ++i)
+        {
+            if (endgame.colors[i] != mover)
+                continue;
+
+            int square = squares[i];
+            Bitboard from = origins(endgame.types[i], mover, square, occupied);
+            while (from)
+            {
+                squares[i] = bit_scan_forward(from);
+                size_t predecessor = tb_index(endgame, mover, squares);
+                if (state[predecessor].load(std::memory_order_relaxed) == UNKNOWN)
+                    marked[predecessor].store(1, std::memory_order_relaxed);
+                from &= from - 1;
+            }
+            squares[i] = square;
+        }
+    }
+
+    bool Builder::decide(size_t index, int pass)
+    {
+        int color_to_move;
+        int squares[TB_MAX_PIECES];
+        tb_squares(endgame, index, color_to_move, squares);
+
+        Position position;
+        tb_position(endgame, color_to_move, squares, position);
+        MoveList moves;
+        generate_legal(position, moves);
+
+        // Entries decided in this pass are pass plies from mate, so only those of earlier passes count here
+        bool all_lose = true;
+        for (const Move& move : moves)
+        {
+            int plies = -1;
+            if (move.captured_type != -1 || move.promotion != -1)
+            {
+                Position child = position;
+                do_move(move, child);
+                int value = child_value(child);
+                if (value && value - 1 < pass)
+                    plies = value - 1;
+            }
+            else
+            {
+                int slot = 0;
+                while (squares[slot] != move.from)
+                    slot++;
+                squares[slot] = move.to;
+                int value = state[tb_index(endgame, color_to_move ^ 1, squares)].load(std::memory_order_relaxed);
+                squares[slot] = move.from;
+                if (value >= DECIDED && value - DECIDED < pass)
+                    plies = value - DECIDED;
+            }
+
+            if (plies >= 0 && plies % 2 == 0)
+            {
+                state[index].store(uint8_t(DECIDED + pass), std::memory_order_relaxed);
+                return true;
+            }
+            if (plies < 0)
+                all_lose = false;
+        }
+
+        if (!all_lose)
+            return false;
+        state[index].store(uint8_t(DECIDED + pass), std::memory_order_relaxed);
+        return true;
+    }
+
+    void Builder::build(WorkStealingPool& pool, GeneratedTable& table)
+    {
+        for_each_chunk(pool, entries, [this](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                initialize(i);
+        });
+
+        int last_wake = *std::max_element(wake.begin(), wake.end());
+        for (int pass = 1; pass <= TB_MAX_PLIES; ++pass)
+        {
+            for_each_chunk(pool, entries, [this, pass](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                    if (state[i].load(std::memory_order_relaxed) == DECIDED + pass - 1)
+                        mark_predecessors(i);
+            });
+
+            std::atomic<size_t> decided { 0 };
+            for_each_chunk(pool, entries, [this, pass, &decided](size_t begin, size_t end)
+            {
+                size_t count = 0;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (state[i].load(std::memory_order_relaxed) != UNKNOWN || (!marked[i].load(std::memory_order_relaxed) && wake[i] != pass))
+                        continue;
+                    marked[i].store(0, std::memory_order_relaxed);
+                    count += decide(i, pass);
+                }
+                decided += count;
+            });
+
+            if (!decided && pass >= last_wake)
+                break;
+        }
+
+        table.endgame = endgame;
+        table.values.assign(entries, 0);
+        for (size_t i = 0; i < entries; ++i)
+        {
+            int value = state[i].load(std::memory_order_relaxed);
+            if (value == ILLEGAL)
+                table.illegal++;
+            else if (value < DECIDED)
+                table.draws++;
+            else
+            {
+                int plies = value - DECIDED;
+                table.values[i] = uint8_t(plies + 1);
+                (plies % 2 ? table.wins : table.losses)++;
+                table.longest_mate = std::max(table.longest_mate, plies);
+            }
+        }
+    }
+}
+
+bool generate_tablebase(const std::string& name, GeneratedTables& tables, int thread_count, std::string& error)
+{
+    Endgame endgame;
+    if (!parse_endgame(name, endgame, error))
+        return false;
+
+    // A double push next to an enemy pawn allows en passant, which the index has no room for
+    size_t split = endgame.name.find('v');
+    if (endgame.name.find('P') < split && endgame.name.find('P', split) != std::string::npos)
+    {
+        error = endgame.name + ": endgames with pawns on both sides are not supported";
+        return false;
+    }
+    if (tables.count(endgame.name))
+        return true;
+
+    std::vector<const GeneratedTable*> children;
+    for (const std::string& child : conversions(endgame))
+    {
+        if (!generate_tablebase(child, tables, thread_count, error))
+            return false;
+        children.push_back(&tables[child]);
+    }
+
+    WorkStealingPool pool(thread_count);
+    GeneratedTable table;
+    Builder(endgame, children).build(pool, table);
+    tables[endgame.name] = std::move(table);
+    return true;
+}
+
+bool write_tablebase(const GeneratedTable& table, const std::string& path, std::string& error)
+{
+    uint8_t largest = table.values.empty() ? 0 : *std::max_element(table.values.begin(), table.values.end());
+    uint32_t bits = 1;
+    while ((1u << bits) <= largest)
+        bits++;
+
+    std::vector<unsigned char> packed((table.values.size() * bits + 7) / 8 + 1, 0);
+    for (size_t i = 0; i < table.values.size(); ++i)
+    {
+        size_t bit = i * bits;
+        unsigned value = unsigned(table.values[i]) << (bit % 8);
+        packed[bit / 8] |= (unsigned char)(value & 0xFF);
+        packed[bit / 8 + 1] |= (unsigned char)(value >> 8);
+    }
+
+    char name[NAME_SIZE] = {};
+    std::strncpy(name, table.endgame.name.c_str(), NAME_SIZE - 1);
+    uint32_t entry_count = uint32_t(table.values.size());
+
+    std::ofstream output(path, std::ios::binary);
+    output.write(MAGIC, sizeof(MAGIC));
+    output.write(name, sizeof(name));
+    output.write(reinterpret_cast<const char*>(&entry_count), sizeof(entry_count));
+    output.write(reinterpret_cast<const char*>(&bits), sizeof(bits));
+    output.write(reinterpret_cast<const char*>(packed.data()), std::streamsize(packed.size()));
+
+    if (!output)
+    {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
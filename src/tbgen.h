@@ -0,0 +1,33 @@
+#ifndef TBGEN_H
+#define TBGEN_H
+
+#include "tablebase.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct GeneratedTable
+{
+    Endgame endgame;
+    // Entries in the file's encoding, one byte each
+    std::vector<uint8_t> values;
+    size_t wins = 0;
+    size_t draws = 0;
+    size_t losses = 0;
+    // Positions no game can reach: pieces sharing a square, pawns on the back ranks, the side not to move in check
+    size_t illegal = 0;
+    int longest_mate = 0;
+};
+
+// Built tables by canonical name. A table is built from the tables of the endgames its captures and promotions lead to
+using GeneratedTables = std::map<std::string, GeneratedTable>;
+
+// Builds the table of an endgame by retrograde analysis, after every table it depends on that is not in tables yet.
+// Mates are found first; then each pass marks the predecessors of the positions decided by the previous pass, reached
+// by taking a move back, and decides those of them whose moves now all lose or one of which wins. The passes are split
+// across thread_count threads of a work-stealing pool
+bool generate_tablebase(const std::string& name, GeneratedTables& tables, int thread_count, std::string& error);
+bool write_tablebase(const GeneratedTable& table, const std::string& path, std::string& error);
+
+#endif // TBGEN_H
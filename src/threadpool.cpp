@@ -0,0 +1,105 @@
+#include "threadpool.h"
+
+WorkStealingPool::WorkStealingPool(int thread_count)
+{
+    if (thread_count < 1) thread_count = 1;
+
+    for (int i = 0; i < thread_count; ++i)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (int i = 0; i < thread_count; ++i)
+        threads.emplace_back(&WorkStealingPool::worker_loop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void WorkStealingPool::submit(Task task, int worker)
+{
+    if (worker < 0)
+        worker = int(next_worker++ % workers.size());
+
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->tasks.push_back(std::move(task));
+    }
+    queued++;
+
+    // Taking the sleep mutex orders the notification after a sleeping worker's check of queued
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    work_available.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    all_done.wait(lock, [this] { return pending == 0; });
+}
+
+bool WorkStealingPool::pop(int index, Task& task)
+{
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    if (worker.tasks.empty()) return false;
+
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    queued--;
+    return true;
+}
+
+bool WorkStealingPool::steal(int index, Task& task)
+{
+    int count = size();
+
+    for (int i = 1; i < count; ++i)
+    {
+        Worker& victim = *workers[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (victim.tasks.empty()) continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued--;
+        return true;
+    }
+
+    return false;
+}
+
+void WorkStealingPool::worker_loop(int index)
+{
+    while (true)
+    {
+        Task task;
+
+        if (pop(index, task) || steal(index, task))
+        {
+            task(index);
+
+            if (--pending == 0)
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                all_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        work_available.wait(lock, [this] { return stopping || queued > 0; });
+
+        if (stopping && queued == 0) return;
+    }
+}
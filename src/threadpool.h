@@ -0,0 +1,56 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each owning a deque of tasks. A worker runs its own tasks newest first and,
+// once its deque is empty, steals the oldest task of another worker
+class WorkStealingPool
+{
+public:
+    // Tasks receive the index of the worker running them
+    using Task = std::function<void(int)>;
+
+    explicit WorkStealingPool(int thread_count);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Queues a task on a worker's deque, round robin when worker is -1. Tasks may submit further tasks
+    void submit(Task task, int worker = -1);
+    // Blocks until every submitted task has finished
+    void wait();
+    int size() const { return int(workers.size()); }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleep_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    std::atomic<int> queued { 0 };
+    std::atomic<int> pending { 0 };
+    std::atomic<unsigned> next_worker { 0 };
+    bool stopping = false;
+
+    bool pop(int index, Task& task);
+    bool steal(int index, Task& task);
+    void worker_loop(int index);
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,149 @@
+#include "tt.h"
+#include <algorithm>
+
+namespace
+{
+    /*
+        Data layout:
+        bits  0-5   from square
+        bits  6-11  to square
+        bits 12-14  promotion type + 1, 0 for none
+        bit  15     move present
+        bits 16-23  depth
+        bits 24-25  bound
+        bits 26-41  score, as a 16-bit two's complement value
+        bits 42-49  generation
+    */
+    Bitboard pack(const Move* move, int depth, Bound bound, int score, uint8_t generation)
+    {
+        Bitboard data = 0ULL;
+        if (move)
+            data |= Bitboard(move->from) | Bitboard(move->to) << 6 | Bitboard(move->promotion + 1) << 12 | 1ULL << 15;
+
+        return data | Bitboard(uint8_t(depth)) << 16 | Bitboard(bound) << 24 | Bitboard(uint16_t(int16_t(score))) << 26 | Bitboard(generation) << 42;
+    }
+
+    int data_depth(Bitboard data) { return int((data >> 16) & 0xFF); }
+    Bound data_bound(Bitboard data) { return Bound((data >> 24) & 0x3); }
+    uint8_t data_generation(Bitboard data) { return uint8_t(data >> 42); }
+    bool data_has_move(Bitboard data) { return data & (1ULL << 15); }
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024)
+        count *= 2;
+
+    buckets = std::vector<Bucket>(count);
+    index_mask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (Bucket& bucket : buckets)
+    {
+        for (Slot& slot : bucket.slots)
+        {
+            slot.key.store(0ULL, std::memory_order_relaxed);
+            slot.data.store(0ULL, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+bool TranspositionTable::probe(Bitboard hash, TTEntry& entry) const
+{
+    const Bucket& bucket = buckets[hash & index_mask];
+
+    for (const Slot& slot : bucket.slots)
+    {
+        Bitboard data = slot.data.load(std::memory_order_relaxed);
+        Bitboard key = slot.key.load(std::memory_order_relaxed);
+
+        if ((key ^ data) != hash || data_bound(data) == BOUND_NONE)
+            continue;
+
+        entry.has_move = data_has_move(data);
+        if (entry.has_move)
+        {
+            entry.move.from = Square(data & 0x3F);
+            entry.move.to = Square((data >> 6) & 0x3F);
+            entry.move.promotion = int((data >> 12) & 0x7) - 1;
+        }
+        entry.depth = data_depth(data);
+        entry.bound = data_bound(data);
+        entry.score = int16_t(uint16_t(data >> 26));
+        return true;
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(Bitboard hash, const Move* move, int depth, Bound bound, int score)
+{
+    Bucket& bucket = buckets[hash & index_mask];
+    Slot* replace = nullptr;
+    int replace_value = 0;
+
+    for (Slot& slot : bucket.slots)
+    {
+        Bitboard data = slot.data.load(std::memory_order_relaxed);
+        Bitboard key = slot.key.load(std::memory_order_relaxed);
+
+        // Same position: keep a deeper result from this search unless the new one is exact
+        if ((key ^ data) == hash && data_bound(data) != BOUND_NONE)
+        {
+            if (bound != BOUND_EXACT && data_generation(data) == generation && data_depth(data) > depth + 2)
+                return;
+
+            // A fail low has no best move, but the one found earlier still orders this position well
+            Bitboard kept_move = 0ULL;
+            if (!move && data_has_move(data))
+                kept_move = data & 0xFFFF;
+
+            Bitboard new_data = pack(move, depth, bound, score, generation) | kept_move;
+            slot.key.store(hash ^ new_data, std::memory_order_relaxed);
+            slot.data.store(new_data, std::memory_order_relaxed);
+            return;
+        }
+
+        // Otherwise replace the entry that is least worth keeping: empty, then old, then shallow
+        int age = uint8_t(generation - data_generation(data));
+        int value = data_bound(data) == BOUND_NONE ? -1024 : data_depth(data) - 8 * age;
+
+        if (!replace || value < replace_value)
+        {
+            replace = &slot;
+            replace_value = value;
+        }
+    }
+
+    Bitboard data = pack(move, depth, bound, score, generation);
+    replace->key.store(hash ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    size_t sample = std::min<size_t>(buckets.size(), 1000 / BUCKET_SIZE);
+    int used = 0;
+
+    for (size_t i = 0; i < sample; ++i)
+    {
+        for (const Slot& slot : buckets[i].slots)
+        {
+            Bitboard data = slot.data.load(std::memory_order_relaxed);
+            if (data_bound(data) != BOUND_NONE && data_generation(data) == generation)
+                used++;
+        }
+    }
+
+    return sample ? int(used * 1000 / (sample * BUCKET_SIZE)) : 0;
+}
@@ -0,0 +1,71 @@
+#ifndef TT_H
+#define TT_H
+
+#include "position.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How a stored score relates to the true score of the position
+enum Bound : uint8_t
+{
+    BOUND_NONE  = 0,
+    // Failed low: the true score is at most the stored one
+    BOUND_UPPER = 1,
+    // Failed high: the true score is at least the stored one
+    BOUND_LOWER = 2,
+    BOUND_EXACT = BOUND_UPPER | BOUND_LOWER
+};
+
+// Decoded transposition table entry. Only from, to and promotion of move are stored, which is all operator== compares
+struct TTEntry
+{
+    Move move {};
+    bool has_move = false;
+    int depth = 0;
+    Bound bound = BOUND_NONE;
+    int score = 0;
+};
+
+// Search results keyed by position hash, shared by every search thread. Entries are grouped four to a 64-byte bucket,
+// so a probe touches a single cache line, and each is stored as a (hash ^ data, data) pair of relaxed atomics like
+// PerftTable: an entry torn by a concurrent write no longer XORs back to its hash and reads as a miss
+class TranspositionTable
+{
+public:
+    explicit TranspositionTable(size_t megabytes);
+
+    // Reallocates and clears the table. Must not be called while a search is using it
+    void resize(size_t megabytes);
+    void clear();
+    // Starts a new generation, so entries from earlier searches are replaced first
+    void new_search() { generation = uint8_t(generation + 1); }
+
+    bool probe(Bitboard hash, TTEntry& entry) const;
+    void store(Bitboard hash, const Move* move, int depth, Bound bound, int score);
+
+    // Permille of the table filled by the current search, estimated from the first thousand entries
+    int hashfull() const;
+    size_t size() const { return buckets.size() * BUCKET_SIZE; }
+
+private:
+    static constexpr int BUCKET_SIZE = 4;
+
+    struct Slot
+    {
+        std::atomic<Bitboard> key;
+        std::atomic<Bitboard> data;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Slot slots[BUCKET_SIZE];
+    };
+
+    std::vector<Bucket> buckets;
+    Bitboard index_mask = 0ULL;
+    uint8_t generation = 0;
+};
+
+#endif // TT_H
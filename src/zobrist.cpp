@@ -0,0 +1,67 @@
+#include "zobrist.h"
+
+namespace
+{
+    // splitmix64, so the keys are generated at compile time and identical on every build
+    constexpr Bitboard next_key(Bitboard& state)
+    {
+        Bitboard z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    constexpr ZobristKeys generate_keys()
+    {
+        ZobristKeys keys {};
+        Bitboard state = 0x5EED5EED5EED5EEDULL;
+
+        for (int color = WHITE; color <= BLACK; ++color)
+            for (int type = PAWN; type <= KING; ++type)
+                for (int sq = a1; sq <= h8; ++sq)
+                    keys.pieces[color][type][sq] = next_key(state);
+
+        for (int color = WHITE; color <= BLACK; ++color)
+        {
+            keys.castling[color][0] = next_key(state);
+            keys.castling[color][1] = next_key(state);
+        }
+
+        for (int file = 0; file < 8; ++file)
+            keys.en_passant[file] = next_key(state);
+
+        keys.side = next_key(state);
+
+        return keys;
+    }
+}
+
+constexpr ZobristKeys ZOBRIST = generate_keys();
+
+Bitboard position_hash(const Position& position)
+{
+    Bitboard hash = 0ULL;
+
+    for (int color = WHITE; color <= BLACK; ++color)
+    {
+        for (int type = PAWN; type <= KING; ++type)
+        {
+            Bitboard pieces = position.pieces[color][type];
+            while (pieces)
+            {
+                hash ^= ZOBRIST.pieces[color][type][bit_scan_forward(pieces)];
+                pieces &= pieces - 1;
+            }
+        }
+    }
+
+    hash ^= castling_hash(position);
+
+    if (position.en_passant != -1)
+        hash ^= ZOBRIST.en_passant[position.en_passant % 8];
+
+    if (position.color_to_move == BLACK)
+        hash ^= ZOBRIST.side;
+
+    return hash;
+}
@@ -0,0 +1,36 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "position.h"
+
+// Random keys XORed together to form a 64-bit position hash
+struct ZobristKeys
+{
+    // [color][piece type][square]
+    Bitboard pieces[2][6][64];
+    // [color][0 = kingside, 1 = queenside]
+    Bitboard castling[2][2];
+    // File of the en passant square
+    Bitboard en_passant[8];
+    // Toggled when black is to move
+    Bitboard side;
+};
+
+extern const ZobristKeys ZOBRIST;
+
+// Combined key of both sides' castling rights
+inline Bitboard castling_hash(const Position& position)
+{
+    Bitboard hash = 0ULL;
+    for (int color = WHITE; color <= BLACK; ++color)
+    {
+        if (position.castling_rights[color] & KS) hash ^= ZOBRIST.castling[color][0];
+        if (position.castling_rights[color] & QS) hash ^= ZOBRIST.castling[color][1];
+    }
+    return hash;
+}
+
+// Hash of a position computed from scratch
+Bitboard position_hash(const Position& position);
+
+#endif // ZOBRIST_H
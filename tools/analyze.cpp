@@ -0,0 +1,130 @@
+#include "nnue.h"
+#include "search.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+    std::string score_to_string(int score)
+    {
+        if (!is_mate_score(score))
+            return "cp " + std::to_string(score);
+
+        return "mate " + std::to_string(mate_in_moves(score));
+    }
+
+    void print_result(const SearchResult& result)
+    {
+        std::string pv;
+        for (const Move& move : result.pv)
+            pv += " " + move_to_string(move);
+
+        std::printf("depth %2d  score %-9s  nodes %12llu  nps %10llu  time %7lld  hashfull %4d  pv%s\n",
+                    result.depth, score_to_string(result.score).c_str(), result.nodes, result.nps, result.time_ms, result.hashfull, pv.c_str());
+    }
+
+    void print_usage()
+    {
+        std::printf("usage: analyze [options] [fen]   search a position (starting position when no FEN is given)\n");
+        std::printf("  -d <depth>   maximum depth\n");
+        std::printf("  -n <nodes>   node budget\n");
+        std::printf("  -m <ms>      time budget in milliseconds\n");
+        std::printf("  -H <MB>      transposition table size (default 16)\n");
+        std::printf("  -t <threads> search threads, 0 for one per hardware thread (default 1)\n");
+        std::printf("  -e <file>    evaluate with the NNUE network in file\n");
+        std::printf("  -b <dir>     probe the endgame tablebases in dir\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    SearchLimits limits;
+    size_t hash_mb = 16;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (std::strcmp(argv[arg], "-d") == 0)
+            limits.depth = std::max(1, std::min(MAX_PLY - 1, std::atoi(argv[arg + 1])));
+        else if (std::strcmp(argv[arg], "-n") == 0)
+            limits.nodes = std::strtoull(argv[arg + 1], nullptr, 10);
+        else if (std::strcmp(argv[arg], "-m") == 0)
+            limits.time_ms = std::atoll(argv[arg + 1]);
+        else if (std::strcmp(argv[arg], "-t") == 0)
+        {
+            limits.threads = std::atoi(argv[arg + 1]);
+            if (limits.threads <= 0)
+                limits.threads = std::max(1, int(std::thread::hardware_concurrency()));
+        }
+        else if (std::strcmp(argv[arg], "-H") == 0)
+            hash_mb = size_t(std::max(1, std::atoi(argv[arg + 1])));
+        else if (std::strcmp(argv[arg], "-e") == 0)
+        {
+            std::string error;
+            if (!nnue_load(argv[arg + 1], error))
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return EXIT_FAILURE;
+            }
+            std::printf("evaluation: nnue (%s)\n", nnue_simd());
+        }
+        else if (std::strcmp(argv[arg], "-b") == 0)
+        {
+            std::string error;
+            int count = tablebase_load(argv[arg + 1], error);
+            if (!count)
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return EXIT_FAILURE;
+            }
+            std::printf("tablebases: %d, up to %d pieces\n", count, tablebase_max_pieces());
+        }
+        else
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Without any limit the search would never end
+    if (limits.depth == MAX_PLY - 1 && !limits.nodes && !limits.time_ms)
+        limits.depth = 8;
+
+    // Allow the FEN to be passed unquoted as separate arguments
+    std::string fen;
+    for (int i = arg; i < argc; ++i)
+        fen += (i > arg ? " " : "") + std::string(argv[i]);
+
+    Position position = starting_position;
+    std::string error;
+    if (!fen.empty() && !parse_fen(fen, position, error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+    auto table = std::make_unique<TranspositionTable>(hash_mb);
+    SearchResult result = search(position, limits, *table, {}, print_result);
+
+    if (!result.has_move)
+    {
+        std::printf("no legal moves\n");
+        return EXIT_SUCCESS;
+    }
+
+    if (result.thread_nodes.size() > 1)
+    {
+        std::printf("\n");
+        for (size_t i = 0; i < result.thread_nodes.size(); ++i)
+            std::printf("Thread %2zu: %llu\n", i, result.thread_nodes[i]);
+    }
+
+    std::printf("\nbestmove %s  score %s  nodes %llu  nps %llu\n", move_to_string(result.best_move).c_str(),
+                score_to_string(result.score).c_str(), result.nodes, result.nps);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,477 @@
+#include "cpu.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "moveexec.h"
+#include "nnue.h"
+#include "search.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Opening, middlegame and endgame positions the primitives are measured over
+    const char* CORPUS[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R w KQ - 0 8",
+        "2r3k1/pp3ppp/2n1b3/3p4/3P4/2PB1N2/P4PPP/4R1K1 b - - 3 24",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 50",
+    };
+
+    struct Result
+    {
+        std::string name;
+        double ns_per_op;
+        double stddev_ns;
+        double ops_per_sec;
+        int samples;
+    };
+
+    // A benchmark body runs the operation a given number of times and returns a checksum that keeps the work alive
+    struct Benchmark
+    {
+        const char* name;
+        std::function<Bitboard(long)> run;
+    };
+
+    volatile Bitboard sink;
+
+    double seconds(std::function<Bitboard(long)>& run, long iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        sink = sink + run(iterations);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    Result measure(Benchmark& benchmark, int samples)
+    {
+        // Grow the batch until one sample takes long enough for the clock resolution not to matter
+        long iterations = 1;
+        while (seconds(benchmark.run, iterations) < 0.02)
+            iterations *= 2;
+
+        std::vector<double> ns(samples);
+        for (int i = 0; i < samples; ++i)
+            ns[i] = seconds(benchmark.run, iterations) * 1e9 / iterations;
+
+        double mean = 0.0;
+        for (double value : ns) mean += value;
+        mean /= samples;
+
+        double variance = 0.0;
+        for (double value : ns) variance += (value - mean) * (value - mean);
+        variance /= samples > 1 ? samples - 1 : 1;
+
+        return { benchmark.name, mean, std::sqrt(variance), 1e9 / mean, samples };
+    }
+
+    struct Corpus
+    {
+        std::vector<Position> positions;
+        std::vector<Bitboard> bitboards;
+        std::vector<Move> moves;
+        std::vector<int> move_positions;
+        // FEN of every position
+        std::vector<std::string> fens;
+    };
+
+    // The corpus positions plus every position one legal move away, for a wider spread of inputs
+    Corpus build_corpus()
+    {
+        Corpus corpus;
+
+        for (const char* fen : CORPUS)
+        {
+            Position root = fen_to_pos(fen);
+            corpus.positions.push_back(root);
+
+            MoveList list;
+            generate_legal(root, list);
+            for (const Move& move : list)
+            {
+                Position child = root;
+                do_move(move, child);
+                corpus.positions.push_back(child);
+            }
+        }
+
+        for (size_t i = 0; i < corpus.positions.size(); ++i)
+        {
+            const Position& position = corpus.positions[i];
+
+            char fen[FEN_BUFFER_SIZE];
+            pos_to_fen(position, fen, sizeof(fen));
+            corpus.fens.push_back(fen);
+
+            for (int color = WHITE; color <= BLACK; ++color)
+                for (int type = PAWN; type <= KING; ++type)
+                    if (position.pieces[color][type])
+                        corpus.bitboards.push_back(position.pieces[color][type]);
+
+            MoveList list;
+            generate_legal(position, list);
+            for (const Move& move : list)
+            {
+                corpus.moves.push_back(move);
+                corpus.move_positions.push_back(int(i));
+            }
+        }
+
+        return corpus;
+    }
+
+    std::vector<Benchmark> build_benchmarks(const Corpus& corpus)
+    {
+        const std::vector<Position>& positions = corpus.positions;
+        const std::vector<Bitboard>& bitboards = corpus.bitboards;
+
+        auto over_bitboards = [&bitboards](Bitboard (*op)(Bitboard))
+        {
+            return [&bitboards, op](long n)
+            {
+                Bitboard sum = 0ULL;
+                size_t size = bitboards.size();
+                for (long i = 0; i < n; ++i)
+                    sum += op(bitboards[size_t(i) % size]);
+                return sum;
+            };
+        };
+
+        // Every square of every corpus position, with that position's occupancy
+        auto over_squares = [&positions](Bitboard (*op)(const Position&, Square))
+        {
+            return [&positions, op](long n)
+            {
+                Bitboard sum = 0ULL;
+                size_t size = positions.size() * 64;
+                for (long i = 0; i < n; ++i)
+                {
+                    size_t index = size_t(i) % size;
+                    sum += op(positions[index / 64], Square(index % 64));
+                }
+                return sum;
+            };
+        };
+
+        auto over_positions = [&positions](Bitboard (*op)(const Position&))
+        {
+            return [&positions, op](long n)
+            {
+                Bitboard sum = 0ULL;
+                for (long i = 0; i < n; ++i)
+                    sum += op(positions[size_t(i) % positions.size()]);
+                return sum;
+            };
+        };
+
+        auto over_moves = [&corpus](Bitboard (*op)(const Move&, const Position&))
+        {
+            return [&corpus, op](long n)
+            {
+                Bitboard sum = 0ULL;
+                for (long i = 0; i < n; ++i)
+                {
+                    size_t index = size_t(i) % corpus.moves.size();
+                    sum += op(corpus.moves[index], corpus.positions[corpus.move_positions[index]]);
+                }
+                return sum;
+            };
+        };
+
+        std::vector<Benchmark> benchmarks =
+        {
+            { "bit_scan_forward", over_bitboards([](Bitboard b) { return Bitboard(bit_scan_forward(b)); }) },
+            { "bit_scan_reverse", over_bitboards([](Bitboard b) { return Bitboard(bit_scan_reverse(b)); }) },
+            { "pop_count",        over_bitboards([](Bitboard b) { return Bitboard(pop_count(b)); }) },
+            { "knight_attacks",   over_squares([](const Position&, Square sq) { return knight_attacks(sq); }) },
+            { "king_attacks",     over_squares([](const Position&, Square sq) { return king_attacks(sq); }) },
+            { "get_ray_attacks",  over_squares([](const Position& p, Square sq) { return get_ray_attacks(p.all_occupancy, Direction(sq & 7), sq); }) },
+            { "rook_attacks",     over_squares([](const Position& p, Square sq) { return rook_attacks(p.all_occupancy, sq); }) },
+            { "bishop_attacks",   over_squares([](const Position& p, Square sq) { return bishop_attacks(p.all_occupancy, sq); }) },
+            { "is_attacked",      over_squares([](const Position& p, Square sq) { return Bitboard(is_attacked(p, sq, p.color_to_move ^ 1)); }) },
+            { "attacked_by",      over_squares([](const Position& p, Square sq) { return attacked_by(p, sq, p.color_to_move ^ 1); }) },
+            { "legal_moves",      over_squares([](const Position& p, Square sq) { return legal_moves(p, sq); }) },
+            { "generate_legal",   over_positions([](const Position& p) { MoveList list; generate_legal(p, list); return Bitboard(list.size); }) },
+            { "update_game_state", over_positions([](const Position& p) { Position copy = p; update_game_state(copy); return Bitboard(copy.state); }) },
+            { "do_move",          over_moves([](const Move& m, const Position& p) { Position copy = p; do_move(m, copy); return copy.hash; }) },
+            { "make_move",        over_moves([](const Move& m, const Position& p) { Position copy = p; make_move(m, copy); return copy.hash; }) },
+            { "evaluate",         over_positions([](const Position& p) { return Bitboard(evaluate(p)); }) },
+            { "pos_to_fen",       over_positions([](const Position& p) { char fen[FEN_BUFFER_SIZE]; return Bitboard(pos_to_fen(p, fen, sizeof(fen))); }) },
+            { "parse_fen", [&corpus](long n)
+            {
+                Bitboard sum = 0ULL;
+                Position position;
+                std::string error;
+                for (long i = 0; i < n; ++i)
+                {
+                    parse_fen(corpus.fens[size_t(i) % corpus.fens.size()], position, error);
+                    sum += position.hash;
+                }
+                return sum;
+            } },
+        };
+
+        // The accumulators' contents do not change the cost, so the update and evaluation reuse one. nnue_update
+        // includes the do_move it follows, timed on its own above
+        if (nnue_loaded())
+        {
+            static NnueAccumulator parent, child;
+            benchmarks.push_back({ "nnue_refresh", over_positions([](const Position& p) { nnue_refresh(p, child); return Bitboard(child.values[WHITE][0]); }) });
+            benchmarks.push_back({ "nnue_update", over_moves([](const Move& m, const Position& p)
+            {
+                Position copy = p;
+                do_move(m, copy);
+                nnue_update(parent, copy, m, child);
+                return Bitboard(child.values[WHITE][0]);
+            }) });
+            benchmarks.push_back({ "nnue_evaluate", over_positions([](const Position& p) { return Bitboard(nnue_evaluate(p, parent)); }) });
+        }
+
+        return benchmarks;
+    }
+
+    struct ScalingResult
+    {
+        int threads;
+        double seconds;
+        unsigned long long nodes;
+    };
+
+    // Time to reach a fixed depth on every corpus position, for 1, 2, 4, ... up to max_threads threads.
+    // The table is cleared before each search so every thread count starts from the same state
+    std::vector<ScalingResult> measure_scaling(int max_threads, int depth)
+    {
+        std::vector<int> thread_counts;
+        for (int threads = 1; threads < max_threads; threads *= 2)
+            thread_counts.push_back(threads);
+        thread_counts.push_back(max_threads);
+
+        TranspositionTable table(64);
+        std::vector<ScalingResult> results;
+
+        for (int threads : thread_counts)
+        {
+            ScalingResult result { threads, 0.0, 0ULL };
+
+            for (const char* fen : CORPUS)
+            {
+                table.clear();
+
+                SearchLimits limits;
+                limits.depth = depth;
+                limits.threads = threads;
+
+                auto start = std::chrono::steady_clock::now();
+                result.nodes += search(fen_to_pos(fen), limits, table).nodes;
+                result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            results.push_back(result);
+        }
+
+        return results;
+    }
+
+    void print_scaling(const std::vector<ScalingResult>& results, int depth)
+    {
+        std::printf("time to depth %d over %zu positions\n\n", depth, sizeof(CORPUS) / sizeof(CORPUS[0]));
+        std::printf("%-8s %12s %10s %16s %16s\n", "threads", "seconds", "speedup", "nodes", "nps");
+        for (const ScalingResult& result : results)
+            std::printf("%-8d %12.3f %9.2fx %16llu %16.0f\n", result.threads, result.seconds, results[0].seconds / result.seconds,
+                        result.nodes, result.nodes / result.seconds);
+    }
+
+    void print_scaling_json(const std::vector<ScalingResult>& results, int depth)
+    {
+        std::printf("{\n  \"cpu\": \"%s\",\n  \"depth\": %d,\n  \"smp\": [\n", cpu_feature_string().c_str(), depth);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const ScalingResult& result = results[i];
+            std::printf("    { \"threads\": %d, \"seconds\": %.3f, \"speedup\": %.3f, \"nodes\": %llu, \"nps\": %.0f }%s\n",
+                        result.threads, result.seconds, results[0].seconds / result.seconds, result.nodes, result.nodes / result.seconds,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+
+    struct EvaluationResult
+    {
+        const char* name;
+        double seconds;
+        unsigned long long nodes;
+        std::vector<Move> best_moves;
+    };
+
+    // Time to a fixed depth on every corpus position with the hand-written evaluation and with the network. A net
+    // that is slower per node has to make up for it by needing fewer nodes or finding better moves
+    std::vector<EvaluationResult> compare_evaluations(int depth)
+    {
+        TranspositionTable table(64);
+        std::vector<EvaluationResult> results;
+
+        for (bool use_nnue : { false, true })
+        {
+            EvaluationResult result { use_nnue ? "nnue" : "hand-written", 0.0, 0ULL, {} };
+
+            for (const char* fen : CORPUS)
+            {
+                table.clear();
+
+                SearchLimits limits;
+                limits.depth = depth;
+                limits.use_nnue = use_nnue;
+
+                auto start = std::chrono::steady_clock::now();
+                SearchResult search_result = search(fen_to_pos(fen), limits, table);
+                result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                result.nodes += search_result.nodes;
+                result.best_moves.push_back(search_result.best_move);
+            }
+
+            results.push_back(result);
+        }
+
+        return results;
+    }
+
+    int agreeing_moves(const std::vector<EvaluationResult>& results)
+    {
+        int agree = 0;
+        for (size_t i = 0; i < results[0].best_moves.size(); ++i)
+            agree += results[0].best_moves[i] == results[1].best_moves[i];
+        return agree;
+    }
+
+    void print_evaluations(const std::vector<EvaluationResult>& results, int depth)
+    {
+        std::printf("\ntime to depth %d over %zu positions, nnue kernels: %s\n\n", depth, sizeof(CORPUS) / sizeof(CORPUS[0]), nnue_simd());
+        std::printf("%-14s %12s %16s %16s\n", "evaluation", "seconds", "nodes", "nps");
+        for (const EvaluationResult& result : results)
+            std::printf("%-14s %12.3f %16llu %16.0f\n", result.name, result.seconds, result.nodes, result.nodes / result.seconds);
+        std::printf("\nsame best move on %d of %zu positions\n", agreeing_moves(results), results[0].best_moves.size());
+    }
+
+    void print_table(const std::vector<Result>& results)
+    {
+        std::printf("cpu: %s\n\n", cpu_feature_string().c_str());
+        std::printf("%-18s %12s %10s %16s\n", "benchmark", "ns/op", "+/- ns", "ops/sec");
+        for (const Result& result : results)
+            std::printf("%-18s %12.2f %10.2f %16.0f\n", result.name.c_str(), result.ns_per_op, result.stddev_ns, result.ops_per_sec);
+    }
+
+    void print_json(const std::vector<Result>& results, const std::vector<EvaluationResult>& evaluations, int depth)
+    {
+        std::printf("{\n  \"cpu\": \"%s\",\n  \"benchmarks\": [\n", cpu_feature_string().c_str());
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& result = results[i];
+            std::printf("    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"stddev_ns\": %.3f, \"ops_per_sec\": %.0f, \"samples\": %d }%s\n",
+                        result.name.c_str(), result.ns_per_op, result.stddev_ns, result.ops_per_sec, result.samples, i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]");
+
+        if (!evaluations.empty())
+        {
+            std::printf(",\n  \"nnue_simd\": \"%s\",\n  \"depth\": %d,\n  \"same_best_move\": %d,\n  \"evaluations\": [\n", nnue_simd(), depth, agreeing_moves(evaluations));
+            for (size_t i = 0; i < evaluations.size(); ++i)
+            {
+                const EvaluationResult& result = evaluations[i];
+                std::printf("    { \"name\": \"%s\", \"seconds\": %.3f, \"nodes\": %llu, \"nps\": %.0f }%s\n",
+                            result.name, result.seconds, result.nodes, result.nodes / result.seconds, i + 1 < evaluations.size() ? "," : "");
+            }
+            std::printf("  ]");
+        }
+        std::printf("\n}\n");
+    }
+
+    void print_usage()
+    {
+        std::printf("usage: bench [--json] [--samples <n>] [--filter <substring>]\n");
+        std::printf("       bench [--json] --smp <max threads> [--depth <d>]   search time-to-depth scaling\n");
+        std::printf("       bench [--json] --nnue <file> [--depth <d>]         adds the network's kernels and compares it with the hand-written evaluation\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    int samples = 10;
+    const char* filter = nullptr;
+    int smp_threads = 0;
+    int smp_depth = 7;
+    const char* network = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+            samples = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            filter = argv[++i];
+        else if (std::strcmp(argv[i], "--smp") == 0 && i + 1 < argc)
+            smp_threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+            smp_depth = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--nnue") == 0 && i + 1 < argc)
+            network = argv[++i];
+        else
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::string error;
+    if (network && !nnue_load(network, error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (smp_threads)
+    {
+        std::vector<ScalingResult> scaling = measure_scaling(smp_threads, smp_depth);
+        if (json)
+            print_scaling_json(scaling, smp_depth);
+        else
+            print_scaling(scaling, smp_depth);
+        return EXIT_SUCCESS;
+    }
+
+    Corpus corpus = build_corpus();
+    std::vector<Result> results;
+
+    for (Benchmark& benchmark : build_benchmarks(corpus))
+    {
+        if (filter && !std::strstr(benchmark.name, filter))
+            continue;
+        results.push_back(measure(benchmark, samples));
+    }
+
+    std::vector<EvaluationResult> evaluations;
+    if (network)
+        evaluations = compare_evaluations(smp_depth);
+
+    if (json)
+        print_json(results, evaluations, smp_depth);
+    else
+    {
+        print_table(results);
+        if (network)
+            print_evaluations(evaluations, smp_depth);
+    }
+
+    return EXIT_SUCCESS;
+}
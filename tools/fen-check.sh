@@ -0,0 +1,56 @@
+#!/bin/sh
+# Runs perft on malformed and illegal FENs and checks each is rejected with the expected error, and that well-formed
+# ones are accepted.
+# usage: fen-check.sh <path to perft executable>
+
+perft="$1"
+failures=0
+
+# rejects <expected error> <fen>
+rejects()
+{
+    output=$(timeout 10 "$perft" 1 "$2" 2>&1)
+    status=$?
+    if [ "$status" -ne 1 ] || [ "$output" != "$1" ]; then
+        echo "FAIL $2: exit $status, $output"
+        failures=$((failures + 1))
+    else
+        echo "ok   $2"
+    fi
+}
+
+# accepts <fen>
+accepts()
+{
+    output=$(timeout 10 "$perft" 1 "$1" 2>&1)
+    status=$?
+    if [ "$status" -ne 0 ]; then
+        echo "FAIL $1: exit $status, $output"
+        failures=$((failures + 1))
+    else
+        echo "ok   $1"
+    fi
+}
+
+accepts "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+accepts "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+accepts "8/8/8/8/8/5k2/8/5K1Q b - - 0 1"
+accepts "4k3/8/8/8/8/8/8/4K3"
+
+rejects "FEN board: unknown piece 'X'" "4k3/8/8/8/8/8/8/4K2X w - - 0 1"
+rejects "FEN board: expected 8 ranks of 8 squares" "4k3/8/8/8/8/8/4K3 w - - 0 1"
+rejects "FEN board: black needs exactly one king" "8/8/8/8/8/8/8/4K3 w - - 0 1"
+rejects "FEN board: white needs exactly one king" "4k3/8/8/8/8/8/8/3KK3 w - - 0 1"
+rejects "FEN board: pawn on the first or last rank" "4k3/8/8/8/8/8/8/P3K3 w - - 0 1"
+rejects "FEN board: pawn on the first or last rank" "p3k3/8/8/8/8/8/8/4K3 b - - 0 1"
+rejects "FEN: black is in check with white to move" "8/8/8/8/8/5k2/8/5K1Q w - - 0 1"
+rejects "FEN: white is in check with black to move" "4k3/8/8/8/8/8/8/r3K3 b - - 0 1"
+rejects "FEN: black is in check with white to move" "8/8/8/8/8/5k2/8/5K1Q"
+rejects "FEN side to move: expected w or b, got x" "4k3/8/8/8/8/8/8/4K3 x - - 0 1"
+rejects "FEN castling rights: expected - or some of KQkq, got KX" "4k3/8/8/8/8/8/8/4K3 w KX - 0 1"
+rejects "FEN en passant square: expected - or a square on rank 6, got e3" "4k3/8/8/8/8/8/8/4K3 w - e3 0 1"
+rejects "FEN halfmove clock: expected a number, got x" "4k3/8/8/8/8/8/8/4K3 w - - x 1"
+rejects "FEN move number: expected a number from 1, got 0" "4k3/8/8/8/8/8/8/4K3 w - - 0 0"
+rejects "FEN: unexpected extra after the move number" "4k3/8/8/8/8/8/8/4K3 w - - 0 1 extra"
+
+[ "$failures" -eq 0 ]
@@ -0,0 +1,218 @@
+#include "movegen.h"
+#include "perft.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+    struct SuiteEntry
+    {
+        const char* name;
+        const char* fen;
+        int depth;
+        unsigned long long nodes;
+    };
+
+    // Reference counts from the Chess Programming Wiki perft results page
+    const SuiteEntry PERFT_SUITE[] =
+    {
+        { "start",     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",                 5, 4865609ULL },
+        { "kiwipete",  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",     4, 4085603ULL },
+        { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",                                6, 11030083ULL },
+        { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",         5, 15833292ULL },
+        { "mirrored4", "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",         5, 15833292ULL },
+        { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",                4, 2103487ULL },
+        { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594ULL },
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void print_summary(unsigned long long nodes, double seconds)
+    {
+        std::printf("\nNodes: %llu\n", nodes);
+        std::printf("Time:  %.3f s\n", seconds);
+        std::printf("NPS:   %.0f\n", seconds > 0.0 ? nodes / seconds : 0.0);
+    }
+
+    void print_table_stats(const PerftTableStats& stats)
+    {
+        std::printf("Hash:  %llu probes, %llu hits (%.1f%%)\n", stats.probes, stats.hits, stats.probes ? 100.0 * stats.hits / stats.probes : 0.0);
+    }
+
+    // Single-threaded runs skip the thread pool so their timings stay comparable across movegen changes
+    unsigned long long count_nodes(const Position& position, int depth, int threads, PerftTable* table, PerftTableStats& stats)
+    {
+        if (threads > 1)
+        {
+            ParallelPerftResult result = parallel_perft(position, depth, threads, table);
+            stats.probes += result.table_stats.probes;
+            stats.hits += result.table_stats.hits;
+            return result.nodes;
+        }
+
+        return table ? perft(position, depth, *table, stats) : perft(position, depth);
+    }
+
+    int run_divide(const Position& position, int depth, int threads, PerftTable* table)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<DivideEntry> entries;
+        std::vector<unsigned long long> thread_nodes;
+        PerftTableStats stats;
+
+        if (threads > 1)
+        {
+            ParallelPerftResult result = parallel_perft(position, depth, threads, table);
+            entries = result.divide;
+            thread_nodes = result.thread_nodes;
+            stats = result.table_stats;
+        }
+        else
+            entries = divide(position, depth, table, &stats);
+
+        double seconds = seconds_since(start);
+        unsigned long long total = 0ULL;
+
+        for (const DivideEntry& entry : entries)
+        {
+            std::printf("%s: %llu\n", move_to_string(entry.move).c_str(), entry.nodes);
+            total += entry.nodes;
+        }
+
+        if (!thread_nodes.empty())
+        {
+            std::printf("\n");
+            for (size_t i = 0; i < thread_nodes.size(); ++i)
+                std::printf("Thread %2zu: %llu\n", i, thread_nodes[i]);
+        }
+
+        print_summary(total, seconds);
+        if (table)
+            print_table_stats(stats);
+        return 0;
+    }
+
+    int run_suite(int threads, PerftTable* table)
+    {
+        int failures = 0;
+        PerftTableStats stats;
+        unsigned long long total = 0ULL;
+        auto start = std::chrono::steady_clock::now();
+
+        for (const SuiteEntry& entry : PERFT_SUITE)
+        {
+            auto entry_start = std::chrono::steady_clock::now();
+            unsigned long long nodes = count_nodes(fen_to_pos(entry.fen), entry.depth, threads, table, stats);
+            bool ok = nodes == entry.nodes;
+
+            std::printf("%-10s depth %d  %12llu  %-4s  %.3f s\n", entry.name, entry.depth, nodes, ok ? "ok" : "FAIL", seconds_since(entry_start));
+            if (!ok)
+            {
+                std::printf("           expected %llu\n", entry.nodes);
+                failures++;
+            }
+            total += nodes;
+        }
+
+        print_summary(total, seconds_since(start));
+        if (table)
+            print_table_stats(stats);
+        return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // Times the same perft with copy-make and with make/unmake
+    int run_compare(Position position, int depth)
+    {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long copy_nodes = perft(position, depth);
+        double copy_seconds = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        unsigned long long unmake_nodes = perft_unmake(position, depth);
+        double unmake_seconds = seconds_since(start);
+
+        std::printf("copy-make    %12llu nodes  %.3f s  %12.0f nps\n", copy_nodes, copy_seconds, copy_seconds > 0.0 ? copy_nodes / copy_seconds : 0.0);
+        std::printf("make/unmake  %12llu nodes  %.3f s  %12.0f nps\n", unmake_nodes, unmake_seconds, unmake_seconds > 0.0 ? unmake_nodes / unmake_seconds : 0.0);
+        std::printf("speedup      %.2fx\n", unmake_seconds > 0.0 ? copy_seconds / unmake_seconds : 0.0);
+
+        return copy_nodes == unmake_nodes ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    void print_usage()
+    {
+        std::printf("usage: perft [options] <depth> [fen]   divide and node count (starting position when no FEN is given)\n");
+        std::printf("       perft [options] --suite         check the standard perft positions against their known counts\n");
+        std::printf("       perft --compare <depth> [fen]   time copy-make against make/unmake perft\n");
+        std::printf("  -t <threads>   worker threads, 0 for one per hardware thread (default 1)\n");
+        std::printf("  -H <MB>        cache subtree counts in a hash table of this size (default off)\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = 1;
+    size_t hash_mb = 0;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-' && argv[arg][1] != '-'; arg += 2)
+    {
+        if (std::strcmp(argv[arg], "-t") == 0)
+        {
+            threads = std::atoi(argv[arg + 1]);
+            if (threads <= 0)
+                threads = std::max(1, int(std::thread::hardware_concurrency()));
+        }
+        else if (std::strcmp(argv[arg], "-H") == 0)
+            hash_mb = size_t(std::max(0, std::atoi(argv[arg + 1])));
+        else
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::unique_ptr<PerftTable> table;
+    if (hash_mb)
+        table = std::make_unique<PerftTable>(hash_mb);
+
+    if (arg < argc && std::strcmp(argv[arg], "--suite") == 0)
+        return run_suite(threads, table.get());
+
+    bool compare = arg < argc && std::strcmp(argv[arg], "--compare") == 0;
+    if (compare)
+        arg++;
+
+    int depth = arg < argc ? std::atoi(argv[arg]) : 0;
+    if (depth < 1)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // Allow the FEN to be passed unquoted as separate arguments
+    std::string fen;
+    for (int i = arg + 1; i < argc; ++i)
+        fen += (i > arg + 1 ? " " : "") + std::string(argv[i]);
+
+    Position position = starting_position;
+    std::string error;
+    if (!fen.empty() && !parse_fen(fen, position, error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (compare)
+        return run_compare(position, depth);
+
+    return run_divide(position, depth, threads, table.get());
+}
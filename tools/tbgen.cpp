@@ -0,0 +1,90 @@
+#include "movegen.h"
+#include "tbgen.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Built when no endgame is named
+    const char* DEFAULT_ENDGAMES[] = { "KQvK", "KRvK", "KPvK", "KBNvK", "KQvKR", "KQvKP", "KRvKB", "KRvKN", "KRvKP" };
+
+    void print_usage()
+    {
+        std::printf("usage: tbgen [-t threads] [-o directory] [endgame...]\n");
+        std::printf("  Builds the tables of the named endgames, e.g. KQvKR, and of every endgame they convert into.\n");
+        std::printf("  Without endgames: ");
+        for (const char* name : DEFAULT_ENDGAMES)
+            std::printf("%s ", name);
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = std::max(1, int(std::thread::hardware_concurrency()));
+    std::string directory = ".";
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (std::strcmp(argv[arg], "-t") == 0)
+            threads = std::max(1, std::atoi(argv[arg + 1]));
+        else if (std::strcmp(argv[arg], "-o") == 0)
+            directory = argv[arg + 1];
+        else
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (arg < argc && argv[arg][0] == '-')
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> names(argv + arg, argv + argc);
+    if (names.empty())
+        names.assign(std::begin(DEFAULT_ENDGAMES), std::end(DEFAULT_ENDGAMES));
+
+    GeneratedTables tables;
+    std::vector<std::string> written;
+
+    for (const std::string& name : names)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        if (!generate_tablebase(name, tables, threads, error))
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return EXIT_FAILURE;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Tables built along the way as dependencies are written as well
+        for (const auto& [table_name, table] : tables)
+        {
+            if (std::find(written.begin(), written.end(), table_name) != written.end())
+                continue;
+
+            std::string path = directory + "/" + table_name + ".bbtb";
+            if (!write_tablebase(table, path, error))
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return EXIT_FAILURE;
+            }
+            written.push_back(table_name);
+
+            std::printf("%-8s %10zu wins %10zu draws %10zu losses  longest mate %3d plies  -> %s\n", table_name.c_str(),
+                        table.wins, table.draws, table.losses, table.longest_mate, path.c_str());
+        }
+        std::printf("%s built in %.2f s with %d thread%s\n", name.c_str(), seconds, threads, threads > 1 ? "s" : "");
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#!/bin/sh
+# Pipes command sequences into the uci engine and checks its answers. Every sequence must finish within a few
+# seconds: a command that waits on a search which never ends hangs the engine.
+# usage: uci-check.sh <path to uci executable>
+
+engine="$1"
+failures=0
+
+# check <name> <expected readyok count> <expected bestmove count> <commands...>
+check()
+{
+    name="$1"; ready="$2"; best="$3"; shift 3
+    output=$(printf '%s\n' "$@" | timeout 10 "$engine")
+    status=$?
+    got_ready=$(printf '%s\n' "$output" | grep -c '^readyok$')
+    got_best=$(printf '%s\n' "$output" | grep -c '^bestmove ')
+
+    if [ "$status" -ne 0 ] || [ "$got_ready" -ne "$ready" ] || [ "$got_best" -ne "$best" ]; then
+        echo "FAIL $name: exit $status, $got_ready readyok, $got_best bestmove"
+        failures=$((failures + 1))
+    else
+        echo "ok   $name"
+    fi
+}
+
+check "depth search" 0 1 "uci" "position startpos" "go depth 4" "quit"
+check "piped searches" 0 2 "position startpos" "go depth 3" "position startpos moves e2e4" "go depth 3" "quit"
+check "infinite then stop" 0 1 "position startpos" "go infinite" "stop" "quit"
+check "infinite then ucinewgame" 1 1 "position startpos" "go infinite" "ucinewgame" "isready" "stop" "quit"
+check "infinite then position" 1 2 "position startpos" "go infinite" "position startpos moves e2e4" "go depth 3" "isready" "quit"
+check "infinite then setoption" 1 1 "position startpos" "go infinite" "setoption name Hash value 8" "isready" "quit"
+check "infinite then quit" 0 1 "position startpos" "go infinite" "quit"
+
+# A book of two entries, e2e4 from the start position and e7e5 in reply, keyed with the Polyglot test keys of those
+# positions. Book moves are only played when the engine keys positions exactly like Polyglot
+book=$(mktemp)
+printf '\106\073\226\030\026\221\374\234\003\034\000\001\000\000\000\000' > "$book"
+printf '\202\074\233\120\375\021\101\226\015\044\000\001\000\000\000\000' >> "$book"
+output=$(printf '%s\n' "setoption name BookFile value $book" "position startpos" "go depth 1" "position startpos moves e2e4" \
+    "go depth 1" "quit" | timeout 10 "$engine" | grep -e '^bestmove ' -e '^info string book')
+rm -f "$book"
+if [ "$output" = "$(printf 'info string book move\nbestmove e2e4\ninfo string book move\nbestmove e7e5')" ]; then
+    echo "ok   book moves"
+else
+    echo "FAIL book moves: $output"
+    failures=$((failures + 1))
+fi
+
+[ "$failures" -eq 0 ]
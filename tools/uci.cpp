@@ -0,0 +1,331 @@
+#include "book.h"
+#include "moveexec.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "search.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const char* STARTPOS_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    // Kept back from the clock for the time it takes to report the move
+    const long long MOVE_OVERHEAD_MS = 30;
+    // Moves the remaining time is spread over when the GUI does not say
+    const int DEFAULT_MOVES_TO_GO = 30;
+
+    // Lines from the search thread and the command loop must not interleave
+    std::mutex output_mutex;
+
+    void send(const std::string& line)
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::fputs(line.c_str(), stdout);
+        std::fputc('\n', stdout);
+        std::fflush(stdout);
+    }
+
+    std::string score_to_uci(int score)
+    {
+        if (!is_mate_score(score))
+            return "cp " + std::to_string(score);
+
+        return "mate " + std::to_string(mate_in_moves(score));
+    }
+
+    std::string info_line(const SearchResult& result)
+    {
+        std::string line = "info depth " + std::to_string(result.depth) + " score " + score_to_uci(result.score) +
+                           " nodes " + std::to_string(result.nodes) + " nps " + std::to_string(result.nps) +
+                           " time " + std::to_string(result.time_ms) + " hashfull " + std::to_string(result.hashfull) + " pv";
+        for (const Move& move : result.pv)
+            line += " " + move_to_string(move);
+        return line;
+    }
+
+    class Engine
+    {
+    public:
+        ~Engine() { stop(); }
+
+        void run();
+
+    private:
+        Position position = fen_to_pos(STARTPOS_FEN);
+        // Hashes of the game positions before the current one, for repetition detection
+        std::vector<Bitboard> history;
+
+        std::unique_ptr<TranspositionTable> table = std::make_unique<TranspositionTable>(16);
+        int threads = 1;
+        OpeningBook book;
+
+        std::thread search_thread;
+        std::atomic<bool> stop_flag { false };
+        // The running search only ends on stop
+        bool infinite_search = false;
+
+        void uci();
+        void set_option(std::istringstream& input);
+        void set_position(std::istringstream& input);
+        void go(std::istringstream& input);
+        // Waits for the search, if any, to send its bestmove. Commands that change the engine's state wait like this
+        // rather than cut the search short, so they can be piped in without a stop in between. An infinite search
+        // would never end, so it is stopped first
+        void wait();
+        void stop();
+    };
+
+    void Engine::run()
+    {
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            std::istringstream input(line);
+            std::string command;
+            input >> command;
+
+            if (command == "uci")
+                uci();
+            else if (command == "isready")
+                send("readyok");
+            else if (command == "setoption")
+            {
+                wait();
+                set_option(input);
+            }
+            else if (command == "ucinewgame")
+            {
+                wait();
+                table->clear();
+            }
+            else if (command == "position")
+            {
+                wait();
+                set_position(input);
+            }
+            else if (command == "go")
+            {
+                wait();
+                go(input);
+            }
+            else if (command == "stop")
+                stop();
+            else if (command == "quit")
+                break;
+            else if (!command.empty())
+                send("info string unknown command " + command);
+        }
+    }
+
+    void Engine::uci()
+    {
+        send("id name BitboardChess");
+        send("id author BitboardChessGUI contributors");
+        send("option name Hash type spin default 16 min 1 max 65536");
+        send("option name Threads type spin default 1 min 1 max 256");
+        send("option name EvalFile type string default <empty>");
+        send("option name BookFile type string default <empty>");
+        send("option name TablebasePath type string default <empty>");
+        send("uciok");
+    }
+
+    // setoption name <name> value <value>. Names may contain spaces
+    void Engine::set_option(std::istringstream& input)
+    {
+        std::string token, name, value;
+        input >> token;
+        while (input >> token && token != "value")
+            name += (name.empty() ? "" : " ") + token;
+        std::getline(input >> std::ws, value);
+
+        if (name == "Hash")
+            table->resize(size_t(std::max(1, std::atoi(value.c_str()))));
+        else if (name == "Threads")
+            threads = std::max(1, std::atoi(value.c_str()));
+        else if (name == "EvalFile")
+        {
+            std::string error;
+            if (value.empty() || value == "<empty>")
+                nnue_unload();
+            else if (nnue_load(value, error))
+                send("info string loaded " + value + " (" + nnue_simd() + ")");
+            else
+                send("info string " + error);
+        }
+        else if (name == "BookFile")
+        {
+            std::string error;
+            if (value.empty() || value == "<empty>")
+                book.close();
+            else if (book.open(value, error))
+                send("info string loaded " + value);
+            else
+                send("info string " + error);
+        }
+        else if (name == "TablebasePath")
+        {
+            std::string error;
+            if (value.empty() || value == "<empty>")
+                tablebase_unload();
+            else if (int count = tablebase_load(value, error))
+                send("info string " + std::to_string(count) + " tablebases, up to " + std::to_string(tablebase_max_pieces()) + " pieces");
+            else
+                send("info string " + error);
+        }
+        else
+            send("info string unknown option " + name);
+    }
+
+    // position [startpos | fen <fen>] [moves <move>...]
+    void Engine::set_position(std::istringstream& input)
+    {
+        std::string token, fen;
+        input >> token;
+
+        if (token == "startpos")
+        {
+            fen = STARTPOS_FEN;
+            input >> token;
+        }
+        else if (token == "fen")
+        {
+            while (input >> token && token != "moves")
+                fen += (fen.empty() ? "" : " ") + token;
+        }
+        else
+            return;
+
+        Position parsed;
+        std::string error;
+        if (!parse_fen(fen, parsed, error))
+        {
+            send("info string " + error);
+            return;
+        }
+
+        position = parsed;
+        history.clear();
+
+        if (token != "moves")
+            return;
+
+        while (input >> token)
+        {
+            MoveList list;
+            generate_legal(position, list);
+
+            const Move* move = std::find_if(list.begin(), list.end(), [&token](const Move& m) { return move_to_string(m) == token; });
+            if (move == list.end())
+            {
+                send("info string illegal move " + token);
+                return;
+            }
+
+            history.push_back(position.hash);
+            do_move(*move, position);
+        }
+    }
+
+    // go [depth <d>] [nodes <n>] [movetime <ms>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>] [infinite]
+    void Engine::go(std::istringstream& input)
+    {
+        SearchLimits limits;
+        limits.threads = threads;
+
+        long long time[2] = { 0, 0 };
+        long long increment[2] = { 0, 0 };
+        int moves_to_go = DEFAULT_MOVES_TO_GO;
+        bool infinite = false;
+
+        std::string token;
+        while (input >> token)
+        {
+            if (token == "depth")
+            {
+                input >> limits.depth;
+                limits.depth = std::max(1, std::min(MAX_PLY - 1, limits.depth));
+            }
+            else if (token == "nodes")
+                input >> limits.nodes;
+            else if (token == "movetime")
+                input >> limits.time_ms;
+            else if (token == "wtime")
+                input >> time[WHITE];
+            else if (token == "btime")
+                input >> time[BLACK];
+            else if (token == "winc")
+                input >> increment[WHITE];
+            else if (token == "binc")
+                input >> increment[BLACK];
+            else if (token == "movestogo")
+                input >> moves_to_go;
+            else if (token == "infinite")
+                infinite = true;
+        }
+
+        // An even share of the clock plus most of the increment, never more than what is left
+        int us = position.color_to_move;
+        if (!limits.time_ms && time[us])
+        {
+            long long budget = time[us] / std::max(1, moves_to_go) + increment[us] * 3 / 4;
+            limits.time_ms = std::max(1LL, std::min(budget, time[us] - MOVE_OVERHEAD_MS));
+        }
+
+        // Book moves are played at once, except when analysing
+        Move book_move;
+        if (!infinite && book.pick(position, book_move))
+        {
+            send("info string book move");
+            send("bestmove " + move_to_string(book_move));
+            return;
+        }
+
+        stop_flag.store(false);
+        limits.stop = &stop_flag;
+        infinite_search = infinite;
+
+        search_thread = std::thread([this, limits, infinite]()
+        {
+            SearchResult result = search(position, limits, *table, history, [](const SearchResult& iteration) { send(info_line(iteration)); });
+
+            // UCI forbids sending bestmove during an infinite search before stop
+            while (infinite && !stop_flag.load())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            std::string best = result.has_move ? move_to_string(result.best_move) : "0000";
+            send("bestmove " + best);
+        });
+    }
+
+    void Engine::wait()
+    {
+        if (infinite_search)
+            stop_flag.store(true);
+        if (search_thread.joinable())
+            search_thread.join();
+    }
+
+    void Engine::stop()
+    {
+        stop_flag.store(true);
+        wait();
+    }
+}
+
+int main()
+{
+    Engine engine;
+    engine.run();
+    return 0;
+}